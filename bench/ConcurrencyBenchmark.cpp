@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Logger.hpp"
+#include "Stabilizer.hpp"
+#include "SyntheticVideo.hpp"
+#include "YuvFrame.hpp"
+
+namespace {
+
+const int DEFAULT_BENCH_FRAMES = 60;
+const int NV12_ROW_PADDING = 64;  // шаг строки NV12 больше ширины, как у буфера декодера
+const uint64_t SECOND_CLIP_SEED = 777;
+
+// Ролик в памяти: кадры лежат в buffers, frames - виды на них в формате format
+struct Clip {
+    const char* name;
+    PixelFormat format;
+    std::vector<cv::Mat> buffers;
+    std::vector<cv::Mat> frames;
+};
+
+struct RunResult {
+    std::vector<cv::Mat> images;
+    double seconds = 0.0;
+};
+
+Clip makeBgrClip(const SyntheticVideo& video) {
+    Clip clip{"BGR", PixelFormat::BGR, {}, {}};
+    for (int i = 0; i < video.frameCount(); i++) {
+        cv::Mat frame;
+        video.renderFrame(i, frame);
+        clip.frames.push_back(frame);
+    }
+    return clip;
+}
+
+// NV12 собирается из I420: плоскость Y как есть, U и V чередуются в одной плоскости.
+// Кадр - вид на буфер с шагом строки width + NV12_ROW_PADDING.
+Clip makeNv12Clip(const SyntheticVideo& video) {
+    Clip clip{"NV12 (шаг строки > ширины)", PixelFormat::NV12, {}, {}};
+    const cv::Size size = video.frameSize();
+    cv::Mat bgr;
+    cv::Mat i420;
+    for (int i = 0; i < video.frameCount(); i++) {
+        video.renderFrame(i, bgr);
+        cv::cvtColor(bgr, i420, cv::COLOR_BGR2YUV_I420);
+        I420Planes planes = splitI420(i420);
+
+        cv::Mat buffer(size.height * 3 / 2, size.width + NV12_ROW_PADDING, CV_8UC1,
+                       cv::Scalar(0));
+        cv::Mat frame = buffer.colRange(0, size.width);
+        Nv12Planes target = splitNV12(frame);
+        planes.y.copyTo(target.y);
+        const cv::Mat chroma[] = {planes.u, planes.v};
+        cv::merge(chroma, 2, target.uv);
+
+        clip.buffers.push_back(buffer);
+        clip.frames.push_back(frame);
+    }
+    return clip;
+}
+
+// Один Stabilizer на весь ролик; кадры передаются видами, без копии
+RunResult stabilizeClip(const Clip& clip, cv::Size frame_size, Logger& logger) {
+    StabilizerOptions options;
+    options.analysis.input_format = clip.format;
+    Stabilizer stabilizer(frame_size, logger, options);
+
+    RunResult result;
+    StabilizedFrame out;
+    auto collect = [&] {
+        while (stabilizer.pull(out)) {
+            result.images.push_back(out.image.clone());
+            stabilizer.recycle(std::move(out.image));
+        }
+    };
+
+    int64 start = cv::getTickCount();
+    for (const cv::Mat& frame : clip.frames) {
+        stabilizer.push(frame);
+        collect();
+    }
+    stabilizer.finish();
+    collect();
+    result.seconds = static_cast<double>(cv::getTickCount() - start) / cv::getTickFrequency();
+    return result;
+}
+
+// Вывод при двух стабилизаторах в двух потоках должен совпасть с выводом одного
+// стабилизатора бит в бит: общего состояния у экземпляров нет
+bool compareRuns(const Clip& clip, const RunResult& single, const RunResult& concurrent) {
+    bool same = single.images.size() == concurrent.images.size();
+    double max_difference = 0.0;
+    for (size_t i = 0; same && i < single.images.size(); i++) {
+        const cv::Mat& a = single.images[i];
+        const cv::Mat& b = concurrent.images[i];
+        if (a.size() != b.size() || a.type() != b.type()) {
+            same = false;
+            break;
+        }
+        max_difference = std::max(max_difference, cv::norm(a, b, cv::NORM_INF));
+    }
+    same = same && max_difference == 0.0;
+
+    cv::Mat first = single.images.empty() ? cv::Mat() : single.images.front();
+    std::cout << "  " << std::left << std::setw(30) << clip.name << std::right
+              << " кадров: " << single.images.size() << " / " << concurrent.images.size()
+              << ", выход " << first.cols << "x" << first.rows << " тип " << first.type()
+              << (same ? " - совпадает" : " - РАСХОДИТСЯ") << ", макс. отличие "
+              << max_difference << std::endl;
+    return same;
+}
+
+}  // namespace
+
+// bench_concurrency [кадров]
+int main(int argc, char** argv) {
+    int frame_count = DEFAULT_BENCH_FRAMES;
+    try {
+        if (argc > 1) {
+            frame_count = std::stoi(argv[1]);
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Использование: bench_concurrency [кадров]" << std::endl;
+        return -1;
+    }
+    if (frame_count < 2) {
+        std::cerr << "Нужно хотя бы 2 кадра" << std::endl;
+        return -1;
+    }
+
+    const cv::Size size(1280, 720);
+    Logger logger("bench_concurrency.log", false);
+    std::cout << "OpenCV потоков: " << cv::getNumThreads() << ", " << size.width << "x"
+              << size.height << ", кадров: " << frame_count << std::endl;
+
+    const Clip clips[] = {makeBgrClip(SyntheticVideo(size, frame_count)),
+                          makeNv12Clip(SyntheticVideo(size, frame_count, SECOND_CLIP_SEED))};
+
+    // Сначала по одному, потом оба одновременно, каждый в своём потоке
+    RunResult single[2];
+    for (int i = 0; i < 2; i++) {
+        single[i] = stabilizeClip(clips[i], size, logger);
+    }
+
+    RunResult concurrent[2];
+    int64 start = cv::getTickCount();
+    std::thread workers[2];
+    for (int i = 0; i < 2; i++) {
+        workers[i] = std::thread(
+            [&, i] { concurrent[i] = stabilizeClip(clips[i], size, logger); });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double concurrent_seconds =
+        static_cast<double>(cv::getTickCount() - start) / cv::getTickFrequency();
+
+    bool all_same = true;
+    for (int i = 0; i < 2; i++) {
+        all_same = compareRuns(clips[i], single[i], concurrent[i]) && all_same;
+    }
+    const double single_seconds = single[0].seconds + single[1].seconds;
+    std::cout << std::fixed << std::setprecision(3) << "  по очереди: " << single_seconds
+              << " с, в двух потоках: " << concurrent_seconds << " с, ускорение x"
+              << single_seconds / concurrent_seconds << std::endl;
+    return all_same ? 0 : 1;
+}
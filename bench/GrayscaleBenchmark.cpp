@@ -0,0 +1,68 @@
+#include <iomanip>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "GrayscaleConverter.hpp"
+
+namespace {
+
+const int BENCH_ITERATIONS = 50;
+
+double measureMPixPerSecond(const cv::Mat& color, GrayscaleConverter::Path path) {
+    cv::Mat gray;
+    GrayscaleConverter::convertToGray(color, gray, path);  // прогрев и аллокация выхода
+
+    int64 start = cv::getTickCount();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+        GrayscaleConverter::convertToGray(color, gray, path);
+    }
+    double seconds = static_cast<double>(cv::getTickCount() - start) / cv::getTickFrequency();
+    return static_cast<double>(color.total()) * BENCH_ITERATIONS / seconds / 1e6;
+}
+
+double maxDifference(const cv::Mat& a, const cv::Mat& b) {
+    double max_diff = 0.0;
+    cv::Mat diff;
+    cv::absdiff(a, b, diff);
+    cv::minMaxLoc(diff, nullptr, &max_diff);
+    return max_diff;
+}
+
+void benchResolution(const cv::Size& size, int threads) {
+    cv::Mat color(size, CV_8UC3);
+    cv::randu(color, cv::Scalar::all(0), cv::Scalar::all(256));
+    // ROI со смещением в 1 пиксель: строки не непрерывны и не выровнены
+    cv::Mat roi = color(cv::Rect(1, 1, size.width - 2, size.height - 2));
+    cv::Mat reference = GrayscaleConverter::convertToGrayReference(roi);
+
+    cv::setNumThreads(threads);
+    for (auto path : {GrayscaleConverter::Path::SCALAR, GrayscaleConverter::Path::SSE2,
+                      GrayscaleConverter::Path::AVX2}) {
+        if (!GrayscaleConverter::isPathSupported(path)) {
+            std::cout << "  " << std::setw(7) << GrayscaleConverter::pathName(path)
+                      << ": не поддерживается процессором" << std::endl;
+            continue;
+        }
+        double mpix = measureMPixPerSecond(roi, path);
+        double diff = maxDifference(GrayscaleConverter::convertToGray(roi, path), reference);
+        std::cout << "  " << std::setw(7) << GrayscaleConverter::pathName(path) << ": "
+                  << std::fixed << std::setprecision(1) << std::setw(8) << mpix
+                  << " MPix/s, макс. отличие от эталона: " << diff << std::endl;
+    }
+}
+
+}  // namespace
+
+int main() {
+    const int max_threads = cv::getNumThreads();
+    const cv::Size resolutions[] = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+
+    for (const auto& size : resolutions) {
+        for (int threads : {1, max_threads}) {
+            std::cout << size.width << "x" << size.height << ", потоков: " << threads
+                      << std::endl;
+            benchResolution(size, threads);
+        }
+    }
+    return 0;
+}
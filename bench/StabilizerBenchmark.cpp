@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "../include/Config.hpp"
+#include "FramePool.hpp"
+#include "FrameRenderer.hpp"
+#include "GrayscaleConverter.hpp"
+#include "GridFeatureDetector.hpp"
+#include "Logger.hpp"
+#include "MotionEstimator.hpp"
+#include "SyntheticVideo.hpp"
+#include "TrajectorySmoother.hpp"
+
+namespace {
+
+const int DEFAULT_BENCH_FRAMES = 60;
+const int SMOOTH_REPEATS = 200;  // траектория короткая - сглаживаем её много раз подряд
+
+// Накопленное время одной стадии
+class StageTimer {
+   public:
+    explicit StageTimer(const char* name) : name(name) {}
+
+    template <typename StageFn>
+    void measure(StageFn stage, int frames = 1) {
+        int64 start = cv::getTickCount();
+        stage();
+        ticks += cv::getTickCount() - start;
+        framesDone += frames;
+    }
+
+    double msPerFrame() const {
+        return framesDone > 0 ? 1000.0 * static_cast<double>(ticks) / cv::getTickFrequency() /
+                                    framesDone
+                              : 0.0;
+    }
+
+    void print() const {
+        double ms = msPerFrame();
+        std::cout << "  " << std::left << std::setw(26) << name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(10) << ms << " мс/кадр  "
+                  << std::setprecision(1) << std::setw(9) << (ms > 0.0 ? 1000.0 / ms : 0.0)
+                  << " fps" << std::endl;
+    }
+
+   private:
+    const char* name;
+    int64 ticks = 0;
+    long framesDone = 0;
+};
+
+// Ошибка оценённой траектории относительно истинной, как в --analysis-report
+void printTrajectoryError(const std::vector<FrameTransformation>& estimated,
+                          const SyntheticVideo& video) {
+    double x = 0, y = 0, a = 0;  // накопленная разница траекторий
+    double sum_sq_xy = 0, sum_sq_a = 0, max_xy = 0, max_a = 0, sum_sq_delta = 0;
+    for (size_t i = 0; i < estimated.size(); i++) {
+        FrameTransformation truth = video.groundTruthDelta(static_cast<int>(i) + 1);
+        double error_x = estimated[i].delta_x - truth.delta_x;
+        double error_y = estimated[i].delta_y - truth.delta_y;
+        x += error_x;
+        y += error_y;
+        a += estimated[i].delta_angle - truth.delta_angle;
+
+        double distance = std::hypot(x, y);
+        sum_sq_xy += distance * distance;
+        sum_sq_a += a * a;
+        sum_sq_delta += error_x * error_x + error_y * error_y;
+        max_xy = std::max(max_xy, distance);
+        max_a = std::max(max_a, std::abs(a));
+    }
+    double n = estimated.empty() ? 1.0 : static_cast<double>(estimated.size());
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "  Ошибка против истинной траектории: сдвиг кадра RMS "
+              << std::sqrt(sum_sq_delta / n) << " пикс; траектория RMS " << std::sqrt(sum_sq_xy / n)
+              << " пикс, макс " << max_xy << " пикс; угол RMS " << std::setprecision(5)
+              << std::sqrt(sum_sq_a / n) << " рад, макс " << max_a << " рад" << std::endl;
+}
+
+void benchResolution(const char* label, cv::Size size, int frame_count,
+                     const AnalysisOptions& options, Logger& logger) {
+    std::cout << label << " (" << size.width << "x" << size.height << "), кадров: " << frame_count
+              << std::endl;
+    SyntheticVideo video(size, frame_count);
+
+    StageTimer gray_timer("convertToGray");
+    StageTimer features_timer("goodFeatures + LK");
+    StageTimer grid_timer("поиск точек по сетке");
+    StageTimer affine_timer("estimateAffinePartial2D");
+    StageTimer estimator_timer("MotionEstimator (итого)");
+    StageTimer phase_timer("фазовая корреляция (translation)");
+    StageTimer smooth_timer("сглаживание (box)");
+    StageTimer render_timer("warp/crop/resize");
+    StageTimer encode_timer("кодирование");
+
+    const int crop_y = DEFAULT_BORDER_CROP_PIXELS;
+    const int crop_x = DEFAULT_BORDER_CROP_PIXELS * size.width / size.height;
+
+    std::string encoded_path =
+        (std::filesystem::temp_directory_path() / "bench_stabilizer.mp4").string();
+    cv::VideoWriter writer(encoded_path, cv::VideoWriter::fourcc('a', 'v', 'c', '1'), 30.0,
+                           size);
+    if (!writer.isOpened()) {
+        writer.open(encoded_path, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), 30.0, size);
+    }
+
+    MotionEstimator estimator(logger, options);
+    AnalysisOptions phase_options = options;
+    phase_options.motion_model = MotionModel::TRANSLATION;
+    phase_options.phase_correlation = true;
+    MotionEstimator phase_estimator(logger, phase_options);
+    std::vector<FrameTransformation> estimated;
+    cv::Mat frame;
+    cv::Mat stabilized_frame;
+    cv::Mat previous_gray;
+    cv::Mat current_gray;
+    PingPongFrames analysis_grey;
+    GridFeatureDetector grid_detector;
+    std::vector<cv::Point2f> grid_points;
+    std::vector<cv::Point2f> previous_points;
+    std::vector<cv::Point2f> current_points;
+    std::vector<uchar> status;
+    std::vector<float> error;
+
+    for (int i = 0; i < frame_count; i++) {
+        video.renderFrame(i, frame);
+
+        gray_timer.measure([&] { GrayscaleConverter::convertToGray(frame, current_gray); });
+        MotionEstimator::prepareGreyFrame(frame, analysis_grey.current, options);
+
+        if (i > 0) {
+            // Отдельно поиск точек + LK и RANSAC - те же параметры, что в MotionEstimator
+            features_timer.measure([&] {
+                goodFeaturesToTrack(previous_gray, previous_points, GOOD_FEATURES_MAX_POINTS,
+                                    GOOD_FEATURES_POINT_QUALITY, GOOD_FEATURES_POINTS_MIN_DIST_PX);
+                calcOpticalFlowPyrLK(previous_gray, current_gray, previous_points,
+                                     current_points, status, error,
+                                     cv::Size(LK_WINDOW_SIZE, LK_WINDOW_SIZE), LK_MAX_LEVEL);
+            });
+            grid_timer.measure([&] {
+                grid_points.clear();
+                grid_detector.detect(previous_gray, GOOD_FEATURES_MAX_POINTS,
+                                     GOOD_FEATURES_POINT_QUALITY,
+                                     GOOD_FEATURES_POINTS_MIN_DIST_PX, cv::Mat(), grid_points);
+            });
+            size_t kept = 0;
+            for (size_t k = 0; k < status.size(); k++) {
+                if (status[k] == SUCCESS_TRACKING_STATUS) {
+                    previous_points[kept] = previous_points[k];
+                    current_points[kept] = current_points[k];
+                    kept++;
+                }
+            }
+            previous_points.resize(kept);
+            current_points.resize(kept);
+            if (!previous_points.empty()) {
+                affine_timer.measure(
+                    [&] { estimateAffinePartial2D(previous_points, current_points); });
+            }
+
+            // Качество меряем по настоящему MotionEstimator
+            estimator_timer.measure([&] {
+                estimated.push_back(
+                    estimator.estimate(analysis_grey.previous, analysis_grey.current));
+            });
+            phase_timer.measure(
+                [&] { phase_estimator.estimate(analysis_grey.previous, analysis_grey.current); });
+
+            render_timer.measure([&] {
+                renderStabilizedFrame(frame, video.groundTruthDelta(i), crop_x, crop_y,
+                                      stabilized_frame);
+            });
+            if (writer.isOpened()) {
+                encode_timer.measure([&] { writer.write(stabilized_frame); });
+            }
+        }
+
+        cv::swap(previous_gray, current_gray);
+        analysis_grey.advance();
+    }
+
+    MotionTrajectorySoA trajectory;
+    trajectory.resize(estimated.size());
+    double x = 0, y = 0, a = 0;
+    for (size_t i = 0; i < estimated.size(); i++) {
+        x += estimated[i].delta_x;
+        y += estimated[i].delta_y;
+        a += estimated[i].delta_angle;
+        trajectory.position_x[i] = x;
+        trajectory.position_y[i] = y;
+        trajectory.angle[i] = a;
+    }
+    std::unique_ptr<TrajectorySmoother> smoother =
+        createTrajectorySmoother("box", NFRAMES_SMOOTH_COEF);
+    smooth_timer.measure(
+        [&] {
+            for (int r = 0; r < SMOOTH_REPEATS; r++) {
+                smoother->smooth(trajectory);
+            }
+        },
+        static_cast<int>(estimated.size()) * SMOOTH_REPEATS);
+
+    for (const auto* timer : {&gray_timer, &features_timer, &grid_timer, &affine_timer,
+                              &estimator_timer, &phase_timer, &smooth_timer, &render_timer}) {
+        timer->print();
+    }
+    if (writer.isOpened()) {
+        encode_timer.print();
+    } else {
+        std::cout << "  кодирование: VideoWriter не открылся (нет кодека)" << std::endl;
+    }
+
+    double pipeline_ms = gray_timer.msPerFrame() + estimator_timer.msPerFrame() +
+                         smooth_timer.msPerFrame() + render_timer.msPerFrame() +
+                         encode_timer.msPerFrame();
+    std::cout << "  " << std::left << std::setw(26) << "весь цикл (сумма стадий)" << std::right
+              << std::fixed << std::setprecision(3) << std::setw(10) << pipeline_ms
+              << " мс/кадр  " << std::setprecision(1) << std::setw(9) << 1000.0 / pipeline_ms
+              << " fps" << std::endl;
+    printTrajectoryError(estimated, video);
+
+    writer.release();
+    std::remove(encoded_path.c_str());
+}
+
+}  // namespace
+
+// bench_stabilizer [кадров] [уменьшение для анализа]
+int main(int argc, char** argv) {
+    int frame_count = DEFAULT_BENCH_FRAMES;
+    AnalysisOptions options;
+    try {
+        if (argc > 1) {
+            frame_count = std::stoi(argv[1]);
+        }
+        if (argc > 2) {
+            options.downscale = std::max(1, std::min(MAX_ANALYSIS_DOWNSCALE, std::stoi(argv[2])));
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Использование: bench_stabilizer [кадров] [уменьшение для анализа]"
+                  << std::endl;
+        return -1;
+    }
+    if (frame_count < 2) {
+        std::cerr << "Нужно хотя бы 2 кадра" << std::endl;
+        return -1;
+    }
+
+    Logger logger("bench_stabilizer.log", false);
+    std::cout << "OpenCV потоков: " << cv::getNumThreads()
+              << ", анализ с уменьшением в " << options.downscale << " раз" << std::endl;
+
+    const std::pair<const char*, cv::Size> resolutions[] = {
+        {"720p", {1280, 720}}, {"1080p", {1920, 1080}}, {"4K", {3840, 2160}}};
+    for (const auto& [label, size] : resolutions) {
+        benchResolution(label, size, frame_count, options, logger);
+    }
+    return 0;
+}
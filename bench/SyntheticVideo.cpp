@@ -0,0 +1,84 @@
+#include "SyntheticVideo.hpp"
+
+#include <cmath>
+
+namespace {
+
+const double PAN_PERIOD_FRAMES = 240.0;  // период медленной панорамы
+const double MAX_JITTER_ANGLE = 0.004;   // рад
+
+}  // namespace
+
+SyntheticVideo::SyntheticVideo(cv::Size frame_size, int frame_count, uint64_t seed)
+    : frameSize_(frame_size) {
+    cv::RNG rng(seed);
+
+    // Запас сцены вокруг кадра: его съедают панорама, дрожание и поворот
+    const int margin = std::max(32, frame_size.width / 10);
+    scene.create(frame_size.height + 2 * margin, frame_size.width + 2 * margin, CV_8UC3);
+
+    // Размытый шум как фон и много прямоугольников/кругов - углы для goodFeaturesToTrack
+    cv::randu(scene, cv::Scalar::all(0), cv::Scalar::all(256));
+    cv::GaussianBlur(scene, scene, cv::Size(0, 0), 3.0);
+    const int shapes = scene.cols * scene.rows / 12000;
+    for (int i = 0; i < shapes; i++) {
+        cv::Point center(rng.uniform(0, scene.cols), rng.uniform(0, scene.rows));
+        cv::Scalar color(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+        int size = rng.uniform(4, std::max(5, margin / 3));
+        if (i % 2 == 0) {
+            cv::rectangle(scene, cv::Rect(center.x, center.y, size, size * 2 / 3), color,
+                          cv::FILLED);
+        } else {
+            cv::circle(scene, center, size / 2, color, cv::FILLED);
+        }
+    }
+    cv::GaussianBlur(scene, scene, cv::Size(0, 0), 0.8);
+
+    const double pan_amplitude = margin / 3.0;
+    const double jitter_amplitude = margin / 16.0;
+    poses.reserve(frame_count);
+    for (int i = 0; i < frame_count; i++) {
+        double phase = 2.0 * CV_PI * i / PAN_PERIOD_FRAMES;
+        poses.emplace_back(pan_amplitude * std::sin(phase) +
+                               rng.uniform(-jitter_amplitude, jitter_amplitude),
+                           0.5 * pan_amplitude * std::sin(0.7 * phase) +
+                               rng.uniform(-jitter_amplitude, jitter_amplitude),
+                           rng.uniform(-MAX_JITTER_ANGLE, MAX_JITTER_ANGLE));
+    }
+}
+
+cv::Point2d SyntheticVideo::frameOffset(int index) const {
+    const MotionTrajectory& pose = poses[index];
+    const double scene_cx = (scene.cols - 1) / 2.0;
+    const double scene_cy = (scene.rows - 1) / 2.0;
+    const double cos_angle = std::cos(pose.angle);
+    const double sin_angle = std::sin(pose.angle);
+
+    return {(frameSize_.width - 1) / 2.0 + pose.position_x -
+                (cos_angle * scene_cx - sin_angle * scene_cy),
+            (frameSize_.height - 1) / 2.0 + pose.position_y -
+                (sin_angle * scene_cx + cos_angle * scene_cy)};
+}
+
+void SyntheticVideo::renderFrame(int index, cv::Mat& frame) const {
+    const double angle = poses[index].angle;
+    const cv::Point2d offset = frameOffset(index);
+    const cv::Matx23d scene_to_frame(std::cos(angle), -std::sin(angle), offset.x,  //
+                                     std::sin(angle), std::cos(angle), offset.y);
+    cv::warpAffine(scene, frame, scene_to_frame, frameSize_, cv::INTER_LINEAR,
+                   cv::BORDER_REFLECT_101);
+}
+
+// Кадр i: q = R_i p + b_i. Тогда q_i = R_i R_{i-1}^T (q_{i-1} - b_{i-1}) + b_i:
+// поворот на разность углов и сдвиг b_i - R(delta) b_{i-1}
+FrameTransformation SyntheticVideo::groundTruthDelta(int index) const {
+    const double delta_angle = poses[index].angle - poses[index - 1].angle;
+    const cv::Point2d previous = frameOffset(index - 1);
+    const cv::Point2d current = frameOffset(index);
+    const double cos_delta = std::cos(delta_angle);
+    const double sin_delta = std::sin(delta_angle);
+
+    return FrameTransformation(current.x - (cos_delta * previous.x - sin_delta * previous.y),
+                               current.y - (sin_delta * previous.x + cos_delta * previous.y),
+                               delta_angle);
+}
@@ -0,0 +1,35 @@
+#ifndef SYNTHETIC_VIDEO_H
+#define SYNTHETIC_VIDEO_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "MotionTypes.hpp"
+
+// Синтетическое "дрожащее" видео с известной траекторией камеры.
+// Кадр i - окно в большую текстурированную сцену: сцена поворачивается на angle_i вокруг
+// своего центра и сдвигается на (x_i, y_i) - медленная панорама плюс случайное дрожание.
+// Кадры строятся по запросу, так что в памяти всегда одна сцена, а не всё видео.
+class SyntheticVideo {
+   public:
+    SyntheticVideo(cv::Size frame_size, int frame_count, uint64_t seed = 12345);
+
+    void renderFrame(int index, cv::Mat& frame) const;
+
+    // Истинное движение между кадрами index - 1 и index в тех же единицах,
+    // что возвращает MotionEstimator::estimate. index >= 1.
+    FrameTransformation groundTruthDelta(int index) const;
+
+    int frameCount() const { return static_cast<int>(poses.size()); }
+    cv::Size frameSize() const { return frameSize_; }
+
+   private:
+    // Сдвиг в матрице кадра: точка сцены p попадает в R(angle) * (p - center) + offset
+    cv::Point2d frameOffset(int index) const;
+
+    cv::Size frameSize_;
+    cv::Mat scene;
+    std::vector<MotionTrajectory> poses;
+};
+
+#endif  // SYNTHETIC_VIDEO_H
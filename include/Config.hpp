@@ -1,13 +1,50 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <cstddef>
+
 const int GOOD_FEATURES_MAX_POINTS = 200;  // кол-во точек для отслеживания
 const double GOOD_FEATURES_POINT_QUALITY = 0.01;  // коэф качества точек
 const int GOOD_FEATURES_POINTS_MIN_DIST_PX = 30;  // пикселей между хорошими точками отслеживания
+const int FEATURE_GRID_COLS = 6;  // тайлов по горизонтали при поиске точек по сетке
+const int FEATURE_GRID_ROWS = 4;  // и по вертикали
+const int FEATURE_GRID_MIN_TILE_PX = 64;   // мельче тайл не режем - уменьшаем сетку
+const int FEATURE_GRID_TILE_OVERSHOOT = 2;  // тайл ищет до 2 справедливых долей точек
+const double MOTION_INLIER_THRESHOLD_PX = 3.0;  // как порог RANSAC estimateAffinePartial2D
+const int PHASE_CORRELATION_MAX_WIDTH = 480;    // шире кадр для фазовой корреляции уменьшаем
+const double PHASE_CORRELATION_MIN_RESPONSE = 0.03;  // слабее пик - сдвиг не найден
+const size_t TRACKER_REDETECT_POINTS = 100;  // меньше живых точек - ищем новые
+const int LK_WINDOW_SIZE = 21;  // окно Лукаса-Канаде, пикселей
+const int LK_MAX_LEVEL = 3;     // уровней пирамиды Лукаса-Канаде сверх исходного
 const int NFRAMES_SMOOTH_COEF = 10;  // сглаживать по скока кадров влево вправо траекторию движения
 const int MAX_CROP_PIXELS = 500;     // чтобы не ввели кроп на миллион
 const int SUCCESS_TRACKING_STATUS = 1;  // хорошие точки имеют статус 1
 const int ADDITION_PREVIEW_OFFSET = 10;  // рамка между видосами в дебаг компейр режиме
 const int DEFAULT_BORDER_CROP_PIXELS = 20;
+const int PIPELINE_QUEUE_CAPACITY = 4;  // кадров в очереди между стадиями конвейера анализа
+const int MIN_FRAMES_PER_CHUNK = 50;    // короче не режем: перемотка дороже выигрыша
+const int RENDER_WINDOW_EXTRA_FRAMES = 2;  // кадров в полёте сверх числа потоков отрисовки
+const int MAX_ANALYSIS_DOWNSCALE = 16;   // сильнее уменьшать кадр для анализа не даём
+const int LIVE_DEFAULT_LOOKAHEAD = 3;     // кадров вперёд в живом режиме по умолчанию
+const double LIVE_DEFAULT_FPS = 30.0;    // если источник не сообщает частоту кадров
+const size_t LIVE_QUEUE_CAPACITY = 2;    // кадров между захватом и обработкой, старые вытесняются
+const double BUDGET_LOAD_HIGH = 0.9;       // доля бюджета кадра, выше которой упрощаем анализ
+const double BUDGET_LOAD_LOW = 0.45;       // ниже - возвращаем точность
+const double BUDGET_LOAD_SMOOTHING = 0.1;  // вес нового кадра в скользящей средней нагрузки
+const int BUDGET_COOLDOWN_FRAMES = 30;     // кадров между сменами уровня анализа
+const int BUDGET_REDUCED_FEATURES = 120;   // точек на первой ступеньке вниз
+const int BUDGET_REDUCED_LK_WINDOW = 15;   // окно LK на второй ступеньке
+const int BUDGET_REDUCED_LK_MAX_LEVEL = 2;  // и глубина пирамиды
+const int LIVE_REPORT_INTERVAL_FRAMES = 300;  // как часто писать сводку живого режима в лог
+const double LIVE_CROP_GROW_PX = 2.0;    // адаптивная рамка растёт не быстрее, пикс/кадр
+const double LIVE_CROP_SHRINK_PX = 0.1;  // и сужается не быстрее, пикс/кадр
+const int ADAPTIVE_CROP_SEARCH_STEPS = 12;  // шагов бисекции доли поправки, что влезает в рамку
+const size_t LOGGER_RING_CAPACITY = 4096;  // записей в кольце асинхронного логгера
+const int LOGGER_IDLE_WAIT_MS = 5;         // как часто фоновый поток логгера проверяет кольцо
+const size_t YUV_PIPE_BUFFER_BYTES = 4 << 20;  // буфер stdio для Y4M/YUV через пайп
+const size_t LARGE_ALLOCATION_BYTES = 64 * 1024;  // крупнее - считаем кадровым буфером
+const int ALLOCATION_WARMUP_FRAMES = 5;  // кадров до установившегося режима в счётчике аллокаций
+const double KALMAN_PROCESS_NOISE = 4e-3;     // Q: насколько быстро может "плыть" камера
+const double KALMAN_MEASUREMENT_NOISE = 0.25;  // R: насколько шумна измеренная траектория
 
 #endif  // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "AffineWarper.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AFFINE_WARPER_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr int COORD_FRAC_BITS = 32;  // source coordinates are stepped in 32.32 fixed point
+constexpr int INTER_BITS = 5;        // sub-pixel position: 1/32 pixel
+constexpr int INTER_SIZE = 1 << INTER_BITS;
+constexpr int WEIGHT_BITS = 2 * INTER_BITS;  // w00 + w01 + w10 + w11 == 1 << WEIGHT_BITS
+constexpr int64_t COORD_ROUND = int64_t{1} << (COORD_FRAC_BITS - INTER_BITS - 1);
+
+struct SamplePosition {
+    int x;
+    int y;
+    int w00;
+    int w01;
+    int w10;
+    int w11;
+};
+
+inline SamplePosition samplePosition(int64_t fixed_x, int64_t fixed_y) {
+    // Round to the nearest 1/32 first, then split into integer pixel and fraction
+    auto quantized_x = static_cast<int>((fixed_x + COORD_ROUND) >> (COORD_FRAC_BITS - INTER_BITS));
+    auto quantized_y = static_cast<int>((fixed_y + COORD_ROUND) >> (COORD_FRAC_BITS - INTER_BITS));
+    int ax = quantized_x & (INTER_SIZE - 1);
+    int ay = quantized_y & (INTER_SIZE - 1);
+
+    return {quantized_x >> INTER_BITS,       quantized_y >> INTER_BITS,
+            (INTER_SIZE - ax) * (INTER_SIZE - ay), ax * (INTER_SIZE - ay),
+            (INTER_SIZE - ax) * ay,            ax * ay};
+}
+
+// Any of the four neighbours may be outside the frame, they contribute black
+void samplePixelBorder(const cv::Mat& src, const SamplePosition& s, uchar* dst) {
+    const uchar* taps[4] = {nullptr, nullptr, nullptr, nullptr};
+    const int weights[4] = {s.w00, s.w01, s.w10, s.w11};
+    for (int i = 0; i < 4; ++i) {
+        int x = s.x + (i & 1);
+        int y = s.y + (i >> 1);
+        if (x >= 0 && y >= 0 && x < src.cols && y < src.rows) {
+            taps[i] = src.ptr<uchar>(y) + x * 3;
+        }
+    }
+
+    for (int c = 0; c < 3; ++c) {
+        int sum = 1 << (WEIGHT_BITS - 1);
+        for (int i = 0; i < 4; ++i) {
+            if (taps[i] != nullptr) {
+                sum += weights[i] * taps[i][c];
+            }
+        }
+        dst[c] = static_cast<uchar>(sum >> WEIGHT_BITS);
+    }
+}
+
+inline void samplePixelScalar(const uchar* top, const uchar* bottom, const SamplePosition& s,
+                              uchar* dst) {
+    for (int c = 0; c < 3; ++c) {
+        int sum = (1 << (WEIGHT_BITS - 1)) + s.w00 * top[c] + s.w01 * top[c + 3] +
+                  s.w10 * bottom[c] + s.w11 * bottom[c + 3];
+        dst[c] = static_cast<uchar>(sum >> WEIGHT_BITS);
+    }
+}
+
+#ifdef AFFINE_WARPER_X86
+
+// Loads 8 bytes (two BGR pixels + 2 spare) per row, pairs neighbours as (B0,B1)(G0,G1)(R0,R1)
+// in 16-bit lanes and lets madd do the horizontal and vertical interpolation at once
+inline void samplePixelSSE2(const uchar* top, const uchar* bottom, const SamplePosition& s,
+                            uchar* dst) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i t = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(top)), zero);
+    __m128i b =
+        _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(bottom)), zero);
+    t = _mm_unpacklo_epi16(t, _mm_srli_si128(t, 6));
+    b = _mm_unpacklo_epi16(b, _mm_srli_si128(b, 6));
+
+    auto w00 = static_cast<short>(s.w00);
+    auto w01 = static_cast<short>(s.w01);
+    auto w10 = static_cast<short>(s.w10);
+    auto w11 = static_cast<short>(s.w11);
+    __m128i sum = _mm_add_epi32(
+        _mm_madd_epi16(t, _mm_setr_epi16(w00, w01, w00, w01, w00, w01, 0, 0)),
+        _mm_madd_epi16(b, _mm_setr_epi16(w10, w11, w10, w11, w10, w11, 0, 0)));
+    sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << (WEIGHT_BITS - 1))),
+                         WEIGHT_BITS);
+    sum = _mm_packus_epi16(_mm_packs_epi32(sum, zero), zero);
+
+    auto bgr = static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+    std::memcpy(dst, &bgr, 3);
+}
+
+#endif  // AFFINE_WARPER_X86
+
+void warpRows(const cv::Mat& src, cv::Mat& dst, const double* m, const cv::Range& rows,
+              bool use_simd) {
+    const double scale = static_cast<double>(int64_t{1} << COORD_FRAC_BITS);
+    const auto step_x = static_cast<int64_t>(m[0] * scale);
+    const auto step_y = static_cast<int64_t>(m[3] * scale);
+    // SIMD loads 8 bytes starting at x, so it needs x + 2 < cols; the scalar one x + 1 < cols
+    const int fast_max_x = use_simd ? src.cols - 3 : src.cols - 2;
+    const int fast_max_y = src.rows - 2;
+
+    for (int v = rows.start; v < rows.end; ++v) {
+        auto fixed_x = static_cast<int64_t>((m[1] * v + m[2]) * scale);
+        auto fixed_y = static_cast<int64_t>((m[4] * v + m[5]) * scale);
+        uchar* out = dst.ptr<uchar>(v);
+
+        for (int u = 0; u < dst.cols; ++u, out += 3, fixed_x += step_x, fixed_y += step_y) {
+            SamplePosition s = samplePosition(fixed_x, fixed_y);
+
+            if (s.x < 0 || s.y < 0 || s.x > fast_max_x || s.y > fast_max_y) {
+                samplePixelBorder(src, s, out);
+                continue;
+            }
+
+            const uchar* top = src.ptr<uchar>(s.y) + s.x * 3;
+            const uchar* bottom = src.ptr<uchar>(s.y + 1) + s.x * 3;
+#ifdef AFFINE_WARPER_X86
+            if (use_simd) {
+                samplePixelSSE2(top, bottom, s, out);
+                continue;
+            }
+#endif
+            samplePixelScalar(top, bottom, s, out);
+        }
+    }
+}
+
+}  // namespace
+
+void AffineWarper::warpBilinear(const cv::Mat& src, cv::Mat& dst,
+                                const cv::Matx23d& inverse_map, cv::Size dsize, Path path) {
+    if (src.empty() || src.type() != CV_8UC3) {
+        throw std::runtime_error("ERROR: AffineWarper expects a non-empty 8-bit BGR image!");
+    }
+    if (path == Path::AUTO) {
+        path = isPathSupported(Path::SSE2) ? Path::SSE2 : Path::SCALAR;
+    } else if (!isPathSupported(path)) {
+        throw std::runtime_error(std::string("ERROR: unsupported warp path ") + pathName(path));
+    }
+
+    const double* m = inverse_map.val;
+    const bool use_simd = path == Path::SSE2;
+
+    dst.create(dsize, CV_8UC3);
+    cv::parallel_for_(cv::Range(0, dst.rows),
+                      [&](const cv::Range& rows) { warpRows(src, dst, m, rows, use_simd); });
+}
+
+bool AffineWarper::isPathSupported(Path path) {
+    switch (path) {
+        case Path::AUTO:
+        case Path::SCALAR:
+            return true;
+#ifdef AFFINE_WARPER_X86
+        case Path::SSE2:
+            return cv::checkHardwareSupport(CV_CPU_SSE2);
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* AffineWarper::pathName(Path path) {
+    switch (path) {
+        case Path::AUTO:
+            return "auto";
+        case Path::SCALAR:
+            return "scalar";
+        case Path::SSE2:
+            return "sse2";
+    }
+    return "unknown";
+}
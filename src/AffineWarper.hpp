@@ -0,0 +1,21 @@
+#ifndef AFFINE_WARPER_H
+#define AFFINE_WARPER_H
+
+#include <opencv2/opencv.hpp>
+
+// Bilinear affine resampling of 8UC3 frames in one pass: dst(x, y) = src(M * (x, y, 1)), where
+// M is the 2x3 inverse map (dst -> src). Samples outside the source are black, as in warpAffine
+// with BORDER_CONSTANT. Coordinates are quantized to 1/32 pixel and weights to 1/1024, same
+// precision class as OpenCV's INTER_LINEAR; the SSE2 path is bit-exact with the scalar one.
+class AffineWarper {
+   public:
+    enum class Path { AUTO, SCALAR, SSE2 };
+
+    static void warpBilinear(const cv::Mat& src, cv::Mat& dst, const cv::Matx23d& inverse_map,
+                             cv::Size dsize, Path path = Path::AUTO);
+
+    static bool isPathSupported(Path path);
+    static const char* pathName(Path path);
+};
+
+#endif  // AFFINE_WARPER_H
@@ -0,0 +1,82 @@
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <opencv2/opencv.hpp>
+
+#include "../include/Config.hpp"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_large_allocations{0};
+std::atomic<uint64_t> g_bytes{0};
+std::atomic<bool> g_installed{false};
+
+// Выделение делегируется стандартному аллокатору; UMatData остаётся за ним,
+// поэтому освобождение идёт мимо нас и считать его не нужно
+class CountingMatAllocator : public cv::MatAllocator {
+   public:
+    explicit CountingMatAllocator(cv::MatAllocator* base) : base(base) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override {
+        cv::UMatData* u = base->allocate(dims, sizes, type, data, step, flags, usage_flags);
+        if (u != nullptr && data == nullptr) {
+            g_allocations++;
+            g_bytes += u->size;
+            if (u->size >= LARGE_ALLOCATION_BYTES) {
+                g_large_allocations++;
+            }
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* data, cv::AccessFlag access_flags,
+                  cv::UMatUsageFlags usage_flags) const override {
+        return base->allocate(data, access_flags, usage_flags);
+    }
+
+    void deallocate(cv::UMatData* data) const override { base->deallocate(data); }
+
+   private:
+    cv::MatAllocator* base;
+};
+
+}  // namespace
+
+void AllocationCounter::install() {
+    if (g_installed.exchange(true)) {
+        return;
+    }
+    static CountingMatAllocator allocator(cv::Mat::getStdAllocator());
+    cv::Mat::setDefaultAllocator(&allocator);
+}
+
+bool AllocationCounter::isInstalled() { return g_installed.load(); }
+
+AllocationCounter::Snapshot AllocationCounter::snapshot() {
+    return {g_allocations.load(), g_large_allocations.load(), g_bytes.load()};
+}
+
+SteadyStateAllocationProbe::SteadyStateAllocationProbe(const char* stage, Logger& logger)
+    : stage(stage), logger(logger) {}
+
+void SteadyStateAllocationProbe::onFrame() {
+    if (++framesSeen == ALLOCATION_WARMUP_FRAMES) {
+        start = AllocationCounter::snapshot();
+    }
+}
+
+void SteadyStateAllocationProbe::report() const {
+    if (!AllocationCounter::isInstalled() || framesSeen <= ALLOCATION_WARMUP_FRAMES) {
+        return;
+    }
+
+    AllocationCounter::Snapshot end = AllocationCounter::snapshot();
+    auto frames = static_cast<double>(framesSeen - ALLOCATION_WARMUP_FRAMES);
+    logger.log(LogLevel::INFO, "Аллокации cv::Mat (", stage, ", после ", ALLOCATION_WARMUP_FRAMES,
+               " кадров прогрева): ", (end.allocations - start.allocations) / frames,
+               " на кадр, из них крупных: ",
+               (end.large_allocations - start.large_allocations) / frames, ", байт на кадр: ",
+               (end.bytes - start.bytes) / frames);
+}
@@ -0,0 +1,39 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+#include "Logger.hpp"
+
+// Счётчик выделений памяти под cv::Mat: ставит свой аллокатор по умолчанию поверх
+// стандартного. Внутренние рабочие буферы OpenCV (goodFeaturesToTrack, LK, RANSAC) идут
+// мимо cv::Mat и сюда не попадают - счётчик показывает именно кадровые буферы.
+class AllocationCounter {
+   public:
+    struct Snapshot {
+        uint64_t allocations = 0;
+        uint64_t large_allocations = 0;  // от LARGE_ALLOCATION_BYTES - это уже кадры
+        uint64_t bytes = 0;
+    };
+
+    static void install();
+    static bool isInstalled();
+    static Snapshot snapshot();
+};
+
+// Считает выделения памяти в установившемся режиме цикла: с кадра warmup_frames до report()
+class SteadyStateAllocationProbe {
+   public:
+    SteadyStateAllocationProbe(const char* stage, Logger& logger);
+
+    void onFrame();
+    void report() const;
+
+   private:
+    const char* stage;
+    Logger& logger;
+    int framesSeen = 0;
+    AllocationCounter::Snapshot start;
+};
+
+#endif  // ALLOCATION_COUNTER_H
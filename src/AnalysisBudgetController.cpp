@@ -0,0 +1,75 @@
+#include "AnalysisBudgetController.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include "../include/Config.hpp"
+
+AnalysisBudgetController::AnalysisBudgetController(double frame_budget_seconds,
+                                                   const AnalysisQuality& base,
+                                                   int max_downscale)
+    : frameBudget(frame_budget_seconds) {
+    AnalysisQuality quality = base;
+    ladder.push_back(quality);
+
+    if (quality.max_features > BUDGET_REDUCED_FEATURES) {
+        quality.max_features = BUDGET_REDUCED_FEATURES;
+        ladder.push_back(quality);
+    }
+    if (quality.lk_window > BUDGET_REDUCED_LK_WINDOW ||
+        quality.lk_max_level > BUDGET_REDUCED_LK_MAX_LEVEL) {
+        quality.lk_window = std::min(quality.lk_window, BUDGET_REDUCED_LK_WINDOW);
+        quality.lk_max_level = std::min(quality.lk_max_level, BUDGET_REDUCED_LK_MAX_LEVEL);
+        ladder.push_back(quality);
+    }
+    while (quality.downscale * 2 <= max_downscale) {
+        quality.downscale *= 2;
+        ladder.push_back(quality);
+    }
+
+    levelFrames.assign(ladder.size(), 0);
+}
+
+bool AnalysisBudgetController::onFrame(double seconds) {
+    levelFrames[currentLevel]++;
+
+    const double load = seconds / frameBudget;
+    averageLoad = primed ? averageLoad + BUDGET_LOAD_SMOOTHING * (load - averageLoad) : load;
+    primed = true;
+
+    if (++framesSinceChange < BUDGET_COOLDOWN_FRAMES) {
+        return false;
+    }
+
+    if (averageLoad > BUDGET_LOAD_HIGH && currentLevel + 1 < ladder.size()) {
+        currentLevel++;
+    } else if (averageLoad < BUDGET_LOAD_LOW && currentLevel > 0) {
+        currentLevel--;
+    } else {
+        return false;
+    }
+
+    framesSinceChange = 0;
+    changeCount++;
+    return true;
+}
+
+// Каждая смена уровня - отдельной строкой, чтобы потом сопоставить качество и скорость
+void logQualityChange(Logger& logger, size_t frame, const AnalysisBudgetController& budget) {
+    const AnalysisQuality& quality = budget.quality();
+    logger.log(LogLevel::INFO, "Кадр ", frame, ": нагрузка ", budget.load() * 100.0,
+               "% бюджета, уровень анализа ", budget.level(), " из ", budget.levels() - 1,
+               ": точек ", quality.max_features, ", окно LK ", quality.lk_window,
+               ", уровней пирамиды ", quality.lk_max_level, ", уменьшение в ", quality.downscale,
+               " раз");
+}
+
+void logBudgetReport(Logger& logger, const AnalysisBudgetController& budget) {
+    std::ostringstream frames_per_level;
+    const std::vector<uint64_t>& frames = budget.framesPerLevel();
+    for (size_t level = 0; level < frames.size(); level++) {
+        frames_per_level << (level > 0 ? ", " : "") << level << ": " << frames[level];
+    }
+    logger.log(LogLevel::INFO, "Бюджет анализа: смен уровня ", budget.changes(),
+               ", кадров по уровням - ", frames_per_level.str());
+}
@@ -0,0 +1,57 @@
+#ifndef ANALYSIS_BUDGET_CONTROLLER_H
+#define ANALYSIS_BUDGET_CONTROLLER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Logger.hpp"
+#include "MotionEstimator.hpp"
+
+// Держит время анализа кадра в бюджете, двигаясь по лестнице уровней AnalysisQuality:
+// от исходных параметров к всё более дешёвым - меньше точек, потом меньше окно и
+// глубина пирамиды LK, потом уменьшение кадра вдвое, вчетверо... до max_downscale.
+// Дорогие по точности шаги - в конце лестницы. Нагрузка - скользящая средняя времени
+// кадра в долях бюджета: выше BUDGET_LOAD_HIGH - ступенька вниз, ниже BUDGET_LOAD_LOW -
+// ступенька вверх, к точности. Между сменами уровня выдерживается
+// BUDGET_COOLDOWN_FRAMES кадров, чтобы не раскачиваться.
+//
+// Живой режим: бюджет 1/fps источника. --analysis-fps: бюджет анализа при заданной
+// скорости обработки.
+class AnalysisBudgetController {
+   public:
+    AnalysisBudgetController(double frame_budget_seconds, const AnalysisQuality& base,
+                             int max_downscale);
+
+    // Время обработки очередного кадра. true - уровень сменился, новый - в quality()
+    bool onFrame(double seconds);
+
+    const AnalysisQuality& quality() const { return ladder[currentLevel]; }
+    size_t level() const { return currentLevel; }
+    size_t levels() const { return ladder.size(); }
+
+    // Скользящая средняя времени кадра в долях бюджета
+    double load() const { return averageLoad; }
+
+    // Для разбора постфактум: сколько кадров проанализировано на каждом уровне
+    // и сколько раз уровень менялся
+    const std::vector<uint64_t>& framesPerLevel() const { return levelFrames; }
+    uint64_t changes() const { return changeCount; }
+
+   private:
+    double frameBudget;
+    std::vector<AnalysisQuality> ladder;
+    std::vector<uint64_t> levelFrames;
+    size_t currentLevel = 0;
+    double averageLoad = 0.0;
+    bool primed = false;
+    int framesSinceChange = 0;
+    uint64_t changeCount = 0;
+};
+
+// Смена уровня в лог: кадр, нагрузка и новые параметры анализа
+void logQualityChange(Logger& logger, size_t frame, const AnalysisBudgetController& budget);
+
+// Итог по бюджету: сколько раз менялся уровень и сколько кадров на каждом
+void logBudgetReport(Logger& logger, const AnalysisBudgetController& budget);
+
+#endif  // ANALYSIS_BUDGET_CONTROLLER_H
@@ -0,0 +1,173 @@
+#include "AnalysisCache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace {
+
+constexpr std::array<char, 8> CACHE_MAGIC = {'V', 'M', 'C', 'S', 'H', 'I', 'F', 'T'};
+constexpr uint32_t CACHE_VERSION = 2;  // 2 - в FrameTransformation добавлен масштаб
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;  // кэш с машины с другим порядком байт не читаем
+constexpr size_t HASH_SAMPLE_BYTES = 1 << 20;     // хэшируем по 1 МиБ из начала, середины и конца
+
+struct CacheHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t file_size;
+    int64_t modified_ns;
+    uint64_t content_hash;
+    uint64_t params_hash;
+    uint64_t frame_count;
+};
+
+static_assert(std::is_trivially_copyable<FrameTransformation>::value &&
+                  sizeof(FrameTransformation) == 4 * sizeof(double),
+              "FrameTransformation пишется в кэш как есть");
+
+// FNV-1a 64
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t hashFileSamples(const std::string& path, uint64_t file_size) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> buffer(HASH_SAMPLE_BYTES);
+    uint64_t hash = hashBytes(&file_size, sizeof(file_size));
+
+    const uint64_t offsets[] = {0, file_size / 2, file_size > HASH_SAMPLE_BYTES
+                                                       ? file_size - HASH_SAMPLE_BYTES
+                                                       : 0};
+    for (uint64_t offset : offsets) {
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        hash = hashBytes(buffer.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+    return hash;
+}
+
+}  // namespace
+
+AnalysisCache::AnalysisCache(const std::string& video_path, const std::string& analysis_params)
+    : cachePath(video_path + ".vmcache") {
+    struct stat info {};
+    if (stat(video_path.c_str(), &info) != 0) {
+        return;
+    }
+
+    key.file_size = static_cast<uint64_t>(info.st_size);
+    key.modified_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000LL +
+                      info.st_mtim.tv_nsec;
+    key.content_hash = hashFileSamples(video_path, key.file_size);
+    key.params_hash = hashBytes(analysis_params.data(), analysis_params.size());
+    keyValid = true;
+}
+
+bool AnalysisCache::load(std::vector<FrameTransformation>& frame_shift_info,
+                         Logger& logger) const {
+    if (!keyValid) {
+        return false;
+    }
+
+    int fd = open(cachePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(CacheHeader)) {
+        close(fd);
+        return false;
+    }
+
+    const auto mapped_size = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    CacheHeader header{};
+    std::memcpy(&header, mapped, sizeof(header));
+
+    // Записи фиксированного размера: файл ровно заголовок плюс frame_count записей,
+    // лишний хвост - признак обрезанной или чужой записи
+    const size_t payload_size = mapped_size - sizeof(CacheHeader);
+    bool valid = header.magic == CACHE_MAGIC && header.version == CACHE_VERSION &&
+                 header.byte_order == BYTE_ORDER_MARK && header.file_size == key.file_size &&
+                 header.modified_ns == key.modified_ns &&
+                 header.content_hash == key.content_hash &&
+                 header.params_hash == key.params_hash &&
+                 payload_size % sizeof(FrameTransformation) == 0 &&
+                 header.frame_count == payload_size / sizeof(FrameTransformation);
+
+    if (valid) {
+        frame_shift_info.resize(header.frame_count);
+        std::memcpy(frame_shift_info.data(), static_cast<const char*>(mapped) + sizeof(header),
+                    header.frame_count * sizeof(FrameTransformation));
+        logger.log(LogLevel::INFO, "Анализ движения загружен из кэша ", cachePath, " (",
+                   header.frame_count, " кадров)");
+    } else {
+        logger.log(LogLevel::INFO, "Кэш анализа ", cachePath,
+                   " устарел или от других параметров, анализируем заново");
+    }
+
+    munmap(mapped, mapped_size);
+    return valid;
+}
+
+bool AnalysisCache::save(const std::vector<FrameTransformation>& frame_shift_info,
+                         Logger& logger) const {
+    if (!keyValid) {
+        return false;
+    }
+
+    CacheHeader header{CACHE_MAGIC,      CACHE_VERSION,    BYTE_ORDER_MARK,
+                       key.file_size,    key.modified_ns,  key.content_hash,
+                       key.params_hash,  frame_shift_info.size()};
+
+    // Пишем во временный файл и переименовываем: оборванная запись не оставит битый кэш.
+    // Имя своё у процесса и потока - два запуска (или два ролика пакета) на одном видео
+    // не пишут в один временный файл.
+    const std::string temp_path =
+        cachePath + ".tmp." + std::to_string(getpid()) + "." +
+        std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(frame_shift_info.data()),
+                   static_cast<std::streamsize>(frame_shift_info.size() *
+                                                sizeof(FrameTransformation)));
+        if (!file) {
+            logger.log(LogLevel::WARNING, "Не удалось записать кэш анализа ", temp_path);
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temp_path.c_str(), cachePath.c_str()) != 0) {
+        logger.log(LogLevel::WARNING, "Не удалось записать кэш анализа ", cachePath);
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    logger.log(LogLevel::INFO, "Анализ движения сохранён в кэш ", cachePath);
+    return true;
+}
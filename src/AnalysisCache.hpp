@@ -0,0 +1,39 @@
+#ifndef ANALYSIS_CACHE_H
+#define ANALYSIS_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+#include "MotionTypes.hpp"
+
+// Кэш результата анализа движения рядом с видео (<video>.vmcache).
+// Повторный рендер с другой обрезкой или сглаживанием читает сдвиги отсюда и пропускает
+// анализ (ClipStabilizer::analyze) целиком. Файл версионирован и привязан к размеру,
+// времени изменения и выборочному хэшу содержимого видео, а также к параметрам анализа.
+class AnalysisCache {
+   public:
+    // analysis_params - строка параметров, влияющих на результат (см. MotionEstimator)
+    AnalysisCache(const std::string& video_path, const std::string& analysis_params);
+
+    // false - кэша нет, он устарел или повреждён
+    bool load(std::vector<FrameTransformation>& frame_shift_info, Logger& logger) const;
+    bool save(const std::vector<FrameTransformation>& frame_shift_info, Logger& logger) const;
+
+    const std::string& path() const { return cachePath; }
+
+   private:
+    struct Key {
+        uint64_t file_size = 0;
+        int64_t modified_ns = 0;
+        uint64_t content_hash = 0;
+        uint64_t params_hash = 0;
+    };
+
+    std::string cachePath;
+    Key key;
+    bool keyValid = false;
+};
+
+#endif  // ANALYSIS_CACHE_H
@@ -0,0 +1,159 @@
+#include "AnalysisPipeline.hpp"
+
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include "AllocationCounter.hpp"
+#include "BoundedQueue.hpp"
+#include "FramePool.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+AnalysisPipeline::AnalysisPipeline(Logger& logger, const AnalysisOptions& options,
+                                   size_t queue_capacity)
+    : logger(logger), options(options), queueCapacity(queue_capacity) {}
+
+std::vector<FrameTransformation> AnalysisPipeline::run(cv::VideoCapture& video_reader,
+                                                       const ProgressCallback& progress) {
+    BoundedQueue<cv::Mat> color_queue(queueCapacity);
+    BoundedQueue<cv::Mat> grey_queue(queueCapacity);
+    FramePool color_pool;
+    FramePool grey_pool;
+
+    StageStats decode_stats{"decode"};
+    StageStats grey_stats{"grayscale"};
+    StageStats estimate_stats{"features/flow"};
+
+    std::exception_ptr decode_error;
+    std::exception_ptr grey_error;
+    auto wall_start = Clock::now();
+
+    std::thread decode_thread([&] {
+        try {
+            while (true) {
+                auto start = Clock::now();
+                // Буфер, уже отработавший на стадии серого; пустой, пока пул не наполнился
+                cv::Mat frame = color_pool.acquire();
+                timeStage(metrics, Metrics::Stage::DECODE, [&] { video_reader >> frame; });
+                decode_stats.busy_seconds += secondsSince(start);
+                if (frame.empty() || !color_queue.push(std::move(frame))) {
+                    break;
+                }
+                decode_stats.items++;
+            }
+        } catch (...) {
+            decode_error = std::current_exception();
+        }
+        color_queue.close();
+    });
+
+    std::thread grey_thread([&] {
+        try {
+            while (auto frame = color_queue.pop()) {
+                auto start = Clock::now();
+                cv::Mat grey_frame = grey_pool.acquire();
+                timeStage(metrics, Metrics::Stage::GRAYSCALE, [&] {
+                    MotionEstimator::prepareGreyFrame(*frame, grey_frame, options);
+                });
+                color_pool.release(std::move(*frame));
+                grey_stats.busy_seconds += secondsSince(start);
+                if (!grey_queue.push(std::move(grey_frame))) {
+                    break;
+                }
+                grey_stats.items++;
+            }
+        } catch (...) {
+            grey_error = std::current_exception();
+        }
+        grey_queue.close();
+        color_queue.close();  // разблокировать декодер, если мы вышли раньше
+    });
+
+    std::vector<FrameTransformation> frame_shift_info;
+    std::exception_ptr estimate_error;
+    try {
+        MotionEstimator estimator(logger, options);
+        estimator.setMetrics(metrics);
+        SteadyStateAllocationProbe allocation_probe("конвейер анализа", logger);
+        std::optional<cv::Mat> previous_grey_frame = grey_queue.pop();
+        int frame_counter = 1;
+
+        while (previous_grey_frame) {
+            std::optional<cv::Mat> current_grey_frame = grey_queue.pop();
+            if (!current_grey_frame) {
+                break;
+            }
+
+            auto start = Clock::now();
+            FrameTransformation shift = estimator.estimate(*previous_grey_frame,
+                                                           *current_grey_frame);
+            estimate_stats.busy_seconds += secondsSince(start);
+            estimate_stats.items++;
+            frame_shift_info.push_back(shift);
+
+            grey_pool.release(std::move(*previous_grey_frame));
+            previous_grey_frame = std::move(current_grey_frame);
+            allocation_probe.onFrame();
+            progress(frame_counter, estimator.trackedPoints());
+            frame_counter++;
+        }
+        allocation_probe.report();
+    } catch (...) {
+        estimate_error = std::current_exception();
+    }
+
+    grey_queue.close();
+    color_queue.close();
+    decode_thread.join();
+    grey_thread.join();
+    wallSeconds = secondsSince(wall_start);
+
+    decode_stats.output_wait_seconds = color_queue.producerWaitSeconds();
+    decode_stats.queue_occupancy = color_queue.averageOccupancy();
+    grey_stats.input_wait_seconds = color_queue.consumerWaitSeconds();
+    grey_stats.output_wait_seconds = grey_queue.producerWaitSeconds();
+    grey_stats.queue_occupancy = grey_queue.averageOccupancy();
+    estimate_stats.input_wait_seconds = grey_queue.consumerWaitSeconds();
+    stages = {decode_stats, grey_stats, estimate_stats};
+    colorBuffers = color_pool.misses();
+    greyBuffers = grey_pool.misses();
+
+    for (const auto& error : {decode_error, grey_error, estimate_error}) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    return frame_shift_info;
+}
+
+void AnalysisPipeline::logStageReport() const {
+    std::ostringstream header;
+    header << "Конвейер анализа: " << std::fixed << std::setprecision(2) << wallSeconds
+           << " с, очереди по " << queueCapacity << " кадров, буферов выделено: цветных "
+           << colorBuffers << ", серых " << greyBuffers;
+    logger.log(LogLevel::INFO, header.str());
+
+    for (const auto& stage : stages) {
+        double load = wallSeconds > 0.0 ? 100.0 * stage.busy_seconds / wallSeconds : 0.0;
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(2) << "  " << std::left << std::setw(14)
+             << stage.name << " кадров=" << stage.items << " занята=" << stage.busy_seconds
+             << " с (" << std::setprecision(0) << load << "%)" << std::setprecision(2)
+             << " ждала входа=" << stage.input_wait_seconds
+             << " с, ждала выхода=" << stage.output_wait_seconds
+             << " с, очередь=" << stage.queue_occupancy;
+        logger.log(LogLevel::INFO, line.str());
+    }
+}
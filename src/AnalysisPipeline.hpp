@@ -0,0 +1,54 @@
+#ifndef ANALYSIS_PIPELINE_H
+#define ANALYSIS_PIPELINE_H
+
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "../include/Config.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "MotionEstimator.hpp"
+#include "MotionTypes.hpp"
+
+// Конвейерный вариант ClipStabilizer::analyze: декодирование, перевод в серый и оценка движения
+// работают в своих потоках и связаны ограниченными очередями. Результат совпадает
+// с последовательным проходом кадр в кадр.
+class AnalysisPipeline {
+   public:
+    // (номер кадра, сколько точек отследили)
+    using ProgressCallback = std::function<void(int, size_t)>;
+
+    explicit AnalysisPipeline(Logger& logger, const AnalysisOptions& options = {},
+                              size_t queue_capacity = PIPELINE_QUEUE_CAPACITY);
+
+    std::vector<FrameTransformation> run(cv::VideoCapture& video_reader,
+                                         const ProgressCallback& progress);
+
+    // Загрузка стадий за последний run(): время работы, простои на входе/выходе, очереди
+    void logStageReport() const;
+
+    // Задержки стадий покадрово в metrics; nullptr - не писать
+    void setMetrics(Metrics* metrics) { this->metrics = metrics; }
+
+   private:
+    struct StageStats {
+        const char* name;
+        size_t items = 0;
+        double busy_seconds = 0.0;
+        double input_wait_seconds = 0.0;   // ждала данных от предыдущей стадии
+        double output_wait_seconds = 0.0;  // ждала места в очереди следующей стадии
+        double queue_occupancy = 0.0;      // средняя заполненность выходной очереди
+    };
+
+    Logger& logger;
+    AnalysisOptions options;
+    size_t queueCapacity;
+    Metrics* metrics = nullptr;
+    double wallSeconds = 0.0;
+    std::vector<StageStats> stages;
+    size_t colorBuffers = 0;  // сколько кадровых буферов пришлось выделить за прогон
+    size_t greyBuffers = 0;
+};
+
+#endif  // ANALYSIS_PIPELINE_H
@@ -0,0 +1,221 @@
+#include "BatchScheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <opencv2/opencv.hpp>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const STABILIZED_SUFFIX = "_stabilized";
+
+bool isVideoFile(const fs::path& path) {
+    static const std::vector<std::string> video_extensions = {
+        ".mp4", ".avi", ".mov", ".mkv", ".m4v", ".webm", ".mpg", ".mpeg", ".wmv", ".flv", ".y4m"};
+
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return std::find(video_extensions.begin(), video_extensions.end(), extension) !=
+           video_extensions.end();
+}
+
+bool isStabilizedOutput(const fs::path& path) {
+    const std::string stem = path.stem().string();
+    const std::string suffix = STABILIZED_SUFFIX;
+    return stem.size() >= suffix.size() &&
+           stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string trim(const std::string& line) {
+    size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = line.find_last_not_of(" \t\r");
+    return line.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> readManifest(const fs::path& manifest) {
+    std::vector<std::string> clips;
+    std::ifstream input(manifest);
+    std::string line;
+    while (std::getline(input, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        fs::path clip(line);
+        if (clip.is_relative()) {
+            clip = manifest.parent_path() / clip;
+        }
+        clips.push_back(clip.string());
+    }
+    return clips;
+}
+
+uintmax_t fileSizeOrZero(const std::string& path) {
+    std::error_code error;
+    uintmax_t size = fs::file_size(path, error);
+    return error ? 0 : size;
+}
+
+}  // namespace
+
+std::string stabilizedOutputPath(const std::string& input_path) {
+    fs::path path(input_path);
+    std::string extension = path.has_extension() ? path.extension().string() : ".mp4";
+    return (path.parent_path() / (path.stem().string() + STABILIZED_SUFFIX + extension)).string();
+}
+
+std::vector<std::string> collectBatchInputs(const std::string& source) {
+    std::vector<std::string> clips;
+    std::error_code error;
+
+    if (fs::is_directory(source, error)) {
+        for (const auto& entry : fs::directory_iterator(source, error)) {
+            if (entry.is_regular_file() && isVideoFile(entry.path()) &&
+                !isStabilizedOutput(entry.path())) {
+                clips.push_back(entry.path().string());
+            }
+        }
+    } else if (source.find_first_of("*?") != std::string::npos) {
+        std::vector<cv::String> matches;
+        cv::glob(source, matches, false);
+        for (const auto& match : matches) {
+            if (!isStabilizedOutput(fs::path(match))) {
+                clips.push_back(match);
+            }
+        }
+    } else if (fs::is_regular_file(source, error)) {
+        return readManifest(source);
+    }
+
+    std::sort(clips.begin(), clips.end());
+    return clips;
+}
+
+BatchScheduler::BatchScheduler(Logger& logger, int jobs) : logger(logger), jobs(jobs) {}
+
+void BatchScheduler::run(const std::vector<std::string>& clips, const ClipJob& job) {
+    reports.assign(clips.size(), ClipReport());
+    if (clips.empty()) {
+        return;
+    }
+
+    // Самые большие ролики - первыми, чтобы в конце пакета не ждать одного длинного
+    std::vector<size_t> order(clips.size());
+    std::vector<uintmax_t> sizes(clips.size());
+    for (size_t i = 0; i < clips.size(); i++) {
+        order[i] = i;
+        sizes[i] = fileSizeOrZero(clips[i]);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    workersUsed = jobs > 0 ? jobs : cores;
+    workersUsed = std::min(workersUsed, static_cast<int>(clips.size()));
+
+    int previous_threads = cv::getNumThreads();
+    cv::setNumThreads(std::max(1, cores / workersUsed));
+    logger.log(LogLevel::INFO, "Пакет: ", clips.size(), " роликов, параллельно ", workersUsed,
+               ", потоков OpenCV на ролик ", cv::getNumThreads());
+
+    std::atomic<size_t> next_clip{0};
+    std::atomic<size_t> clips_done{0};
+    auto wall_start = Clock::now();
+
+    auto worker = [&] {
+        while (true) {
+            size_t slot = next_clip++;
+            if (slot >= order.size()) {
+                return;
+            }
+            ClipReport& report = reports[order[slot]];
+            report.path = clips[order[slot]];
+
+            auto start = Clock::now();
+            try {
+                report.frames = job(report.path);
+            } catch (const std::exception& e) {
+                logger.log(LogLevel::ERROR, "Exception: ", e.what(), " в ролике ", report.path);
+            } catch (...) {
+                logger.log(LogLevel::ERROR, "Неизвестная ошибка в ролике ", report.path);
+            }
+            report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            size_t done = ++clips_done;
+            if (report.frames < 0) {
+                logger.log(LogLevel::ERROR, "[", done, "/", clips.size(), "] ", report.path,
+                           ": ошибка");
+            } else {
+                logger.log(LogLevel::INFO, "[", done, "/", clips.size(), "] ", report.path, ": ",
+                           report.frames, " кадров за ", report.seconds, " с");
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < workersUsed; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    wallSeconds = std::chrono::duration<double>(Clock::now() - wall_start).count();
+    cv::setNumThreads(previous_threads);
+}
+
+size_t BatchScheduler::failedClips() const {
+    return static_cast<size_t>(std::count_if(reports.begin(), reports.end(),
+                                             [](const ClipReport& r) { return r.frames < 0; }));
+}
+
+void BatchScheduler::logSummary() const {
+    std::vector<double> clip_seconds;
+    long total_frames = 0;
+    for (const auto& report : reports) {
+        if (report.frames >= 0) {
+            clip_seconds.push_back(report.seconds);
+            total_frames += report.frames;
+        }
+    }
+    std::sort(clip_seconds.begin(), clip_seconds.end());
+
+    double wall = std::max(wallSeconds, 1e-9);
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(2) << "Пакет готов: " << clip_seconds.size()
+            << " из " << reports.size() << " роликов за " << wallSeconds << " с, "
+            << clip_seconds.size() / wall << " роликов/с, " << total_frames / wall
+            << " кадров/с, потоков " << workersUsed;
+    logger.log(failedClips() > 0 ? LogLevel::WARNING : LogLevel::INFO, summary.str());
+
+    if (!clip_seconds.empty()) {
+        double mean = 0.0;
+        for (double seconds : clip_seconds) {
+            mean += seconds;
+        }
+        mean /= static_cast<double>(clip_seconds.size());
+
+        std::ostringstream per_clip;
+        per_clip << std::fixed << std::setprecision(2)
+                 << "  Время на ролик: мин " << clip_seconds.front() << " с, медиана "
+                 << clip_seconds[clip_seconds.size() / 2] << " с, среднее " << mean
+                 << " с, макс " << clip_seconds.back() << " с";
+        logger.log(LogLevel::INFO, per_clip.str());
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef BATCH_SCHEDULER_H
+#define BATCH_SCHEDULER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+
+// <dir>/<name>_stabilized.<ext>; без расширения - <name>_stabilized.mp4
+std::string stabilizedOutputPath(const std::string& input_path);
+
+// Список видео для пакетного режима. source - это каталог (все видеофайлы в нём),
+// шаблон с * или ? (cv::glob) или файл-манифест: по пути на строку, '#' - комментарий,
+// относительные пути считаются от каталога манифеста. Результаты прошлых запусков
+// (*_stabilized.*) из каталога и шаблона не берутся.
+std::vector<std::string> collectBatchInputs(const std::string& source);
+
+// Раздаёт ролики пакета рабочим потокам. Ролики независимы и подзадач не порождают, поэтому
+// вместо деков с кражей работы - общий атомарный курсор по списку, отсортированному от
+// больших файлов к маленьким: освободившийся поток сразу берёт следующий ролик, а самые
+// долгие не достаются в конец очереди. Оставшиеся ядра отдаются parallel_for_ внутри ролика:
+// общий пул OpenCV получает cores / jobs потоков.
+class BatchScheduler {
+   public:
+    // Обрабатывает один ролик, возвращает число кадров или отрицательное число при ошибке
+    using ClipJob = std::function<int(const std::string&)>;
+
+    // jobs = 0 - по числу ядер, но не больше числа роликов
+    BatchScheduler(Logger& logger, int jobs);
+
+    void run(const std::vector<std::string>& clips, const ClipJob& job);
+
+    size_t failedClips() const;
+    void logSummary() const;
+
+   private:
+    struct ClipReport {
+        std::string path;
+        int frames = -1;
+        double seconds = 0.0;
+    };
+
+    Logger& logger;
+    int jobs;
+    int workersUsed = 0;
+    double wallSeconds = 0.0;
+    std::vector<ClipReport> reports;
+};
+
+#endif  // BATCH_SCHEDULER_H
@@ -0,0 +1,117 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Ограниченная очередь между двумя стадиями конвейера (один писатель, один читатель).
+// push() блокируется, пока очередь полна - так медленная стадия притормаживает быструю.
+// Считает время ожидания с обеих сторон и среднюю заполненность для отчёта о стадиях.
+template <typename T>
+class BoundedQueue {
+   public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+    // false - очередь закрыта читателем, элемент не принят
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (items.size() >= capacity && !closed) {
+            auto wait_start = std::chrono::steady_clock::now();
+            notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+            pushWaitSeconds += secondsSince(wait_start);
+        }
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        occupancySum += items.size();
+        pushCount++;
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Не ждёт: в полной очереди место освобождается, вытесняя самый старый элемент,
+    // он возвращается в evicted. false - очередь закрыта, элемент не принят.
+    bool pushEvictingOldest(T item, std::optional<T>& evicted) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed) {
+            return false;
+        }
+        if (items.size() >= capacity) {
+            evicted = std::move(items.front());
+            items.pop_front();
+        }
+        items.push_back(std::move(item));
+        occupancySum += items.size();
+        pushCount++;
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // nullopt - очередь закрыта и пуста
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (items.empty() && !closed) {
+            auto wait_start = std::chrono::steady_clock::now();
+            notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+            popWaitSeconds += secondsSince(wait_start);
+        }
+        if (items.empty()) {
+            return std::nullopt;
+        }
+        T item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return item;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    size_t maxSize() const { return capacity; }
+
+    // Средняя заполненность сразу после push, 0..capacity
+    double averageOccupancy() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pushCount > 0 ? static_cast<double>(occupancySum) / pushCount : 0.0;
+    }
+
+    // Сколько писатель простоял на полной очереди
+    double producerWaitSeconds() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pushWaitSeconds;
+    }
+
+    // Сколько читатель простоял на пустой очереди
+    double consumerWaitSeconds() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return popWaitSeconds;
+    }
+
+   private:
+    static double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const size_t capacity;
+    mutable std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<T> items;
+    bool closed = false;
+
+    size_t occupancySum = 0;
+    size_t pushCount = 0;
+    double pushWaitSeconds = 0.0;
+    double popWaitSeconds = 0.0;
+};
+
+#endif  // BOUNDED_QUEUE_H
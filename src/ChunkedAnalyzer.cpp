@@ -0,0 +1,131 @@
+#include "ChunkedAnalyzer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <thread>
+#include <utility>
+
+#include "../include/Config.hpp"
+#include "FramePool.hpp"
+
+ChunkedAnalyzer::ChunkedAnalyzer(std::string video_path, int chunks, Logger& logger,
+                                 const AnalysisOptions& options)
+    : videoPath(std::move(video_path)), chunks(chunks), logger(logger), options(options) {}
+
+int ChunkedAnalyzer::segmentCount(int chunks, int total_frames) {
+    if (chunks <= 0) {
+        chunks = static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+    }
+    // Короткое видео или неизвестное число кадров - один отрезок
+    return std::max(1, std::min(chunks, total_frames / MIN_FRAMES_PER_CHUNK));
+}
+
+std::vector<FrameTransformation> ChunkedAnalyzer::run(const VideoInfo& video_info,
+                                                      const ProgressCallback& progress) {
+    const int total_frames = static_cast<int>(video_info.total_frames);
+    const int segments = segmentCount(chunks, total_frames);
+
+    logger.log(LogLevel::INFO, "Анализ отрезками: ", segments, " шт. по ~",
+               total_frames / segments, " кадров");
+
+    std::atomic<int> frames_done{0};
+    std::vector<std::future<std::vector<FrameTransformation>>> results;
+    for (int i = 0; i < segments; ++i) {
+        int first_frame = total_frames * i / segments;
+        // Последний отрезок читает до конца файла: CAP_PROP_FRAME_COUNT бывает неточным
+        int last_frame = i + 1 < segments ? total_frames * (i + 1) / segments : -1;
+        results.push_back(std::async(std::launch::async, [this, first_frame, last_frame,
+                                                          &frames_done] {
+            return analyzeSegment(first_frame, last_frame, frames_done);
+        }));
+    }
+
+    for (auto& result : results) {
+        while (result.wait_for(std::chrono::milliseconds(200)) != std::future_status::ready) {
+            progress(frames_done.load());
+        }
+    }
+    progress(frames_done.load());
+
+    std::vector<FrameTransformation> frame_shift_info;
+    std::exception_ptr error;
+    for (auto& result : results) {
+        try {
+            std::vector<FrameTransformation> segment = result.get();
+            frame_shift_info.insert(frame_shift_info.end(), segment.begin(), segment.end());
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return frame_shift_info;
+}
+
+// Пары (k-1, k) для k из (first_frame, last_frame]; last_frame < 0 - до конца файла
+std::vector<FrameTransformation> ChunkedAnalyzer::analyzeSegment(int first_frame,
+                                                                 int last_frame,
+                                                                 std::atomic<int>& frames_done) {
+    cv::VideoCapture video_reader(videoPath);
+    if (!video_reader.isOpened()) {
+        throw std::runtime_error("не удалось открыть видео " + videoPath);
+    }
+    seekToFrame(video_reader, first_frame);
+
+    std::vector<FrameTransformation> frame_shift_info;
+    if (last_frame > first_frame) {
+        frame_shift_info.reserve(last_frame - first_frame);
+    }
+
+    MotionEstimator estimator(logger, options);
+    estimator.setMetrics(metrics);
+    cv::Mat current_frame;
+    PingPongFrames grey_frames;
+    auto read_frame = [&] {
+        return timeStage(metrics, Metrics::Stage::DECODE,
+                         [&] { return video_reader.read(current_frame); });
+    };
+    auto prepare_grey_frame = [&](cv::Mat& grey_frame) {
+        ScopedStageTimer timer(metrics, Metrics::Stage::GRAYSCALE);
+        MotionEstimator::prepareGreyFrame(current_frame, grey_frame, options);
+    };
+
+    if (!read_frame()) {
+        return frame_shift_info;
+    }
+    prepare_grey_frame(grey_frames.previous);
+
+    for (int k = first_frame + 1; last_frame < 0 || k <= last_frame; ++k) {
+        if (!read_frame()) {
+            break;
+        }
+        prepare_grey_frame(grey_frames.current);
+        frame_shift_info.push_back(estimator.estimate(grey_frames.previous, grey_frames.current));
+        grey_frames.advance();
+        frames_done++;
+    }
+
+    return frame_shift_info;
+}
+
+void ChunkedAnalyzer::seekToFrame(cv::VideoCapture& video_reader, int frame_index) {
+    if (frame_index == 0) {
+        return;
+    }
+
+    video_reader.set(cv::CAP_PROP_POS_FRAMES, frame_index);
+    if (static_cast<int>(video_reader.get(cv::CAP_PROP_POS_FRAMES)) == frame_index) {
+        return;
+    }
+
+    // Контейнер не умеет точно позиционироваться - честно пропускаем кадры с начала
+    logger.log(LogLevel::WARNING, "Неточное позиционирование на кадр ", frame_index,
+               ", пропускаем кадры последовательно");
+    video_reader.open(videoPath);
+    for (int i = 0; i < frame_index && video_reader.grab(); ++i) {
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef CHUNKED_ANALYZER_H
+#define CHUNKED_ANALYZER_H
+
+#include <atomic>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "MotionEstimator.hpp"
+#include "MotionTypes.hpp"
+
+// Параллельный по времени анализ: видео режется на отрезки, каждый отрезок читается своим
+// cv::VideoCapture и обсчитывается в своём потоке. Отрезок дочитывает первый кадр следующего,
+// поэтому пара кадров на стыке тоже посчитана, и результаты просто склеиваются по порядку.
+class ChunkedAnalyzer {
+   public:
+    // (сколько кадров обработано всеми отрезками)
+    using ProgressCallback = std::function<void(int)>;
+
+    // chunks <= 0 - по числу ядер
+    ChunkedAnalyzer(std::string video_path, int chunks, Logger& logger,
+                    const AnalysisOptions& options = {});
+
+    std::vector<FrameTransformation> run(const VideoInfo& video_info,
+                                         const ProgressCallback& progress);
+
+    // На сколько отрезков режется видео из total_frames кадров. От этого зависят стыки,
+    // а значит и результат - число входит в ключ кэша анализа.
+    static int segmentCount(int chunks, int total_frames);
+
+    // Стадии всех отрезков пишутся в общие metrics; nullptr - не писать
+    void setMetrics(Metrics* metrics) { this->metrics = metrics; }
+
+   private:
+    std::vector<FrameTransformation> analyzeSegment(int first_frame, int last_frame,
+                                                    std::atomic<int>& frames_done);
+    void seekToFrame(cv::VideoCapture& video_reader, int frame_index);
+
+    std::string videoPath;
+    int chunks;
+    Logger& logger;
+    AnalysisOptions options;
+    Metrics* metrics = nullptr;
+};
+
+#endif  // CHUNKED_ANALYZER_H
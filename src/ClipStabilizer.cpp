@@ -0,0 +1,399 @@
+#include "ClipStabilizer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+#include "AllocationCounter.hpp"
+#include "AnalysisBudgetController.hpp"
+#include "FramePool.hpp"
+#include "ParallelRenderPass.hpp"
+
+ClipStabilizer::ClipStabilizer(cv::Size frame_size, Logger& logger, const ClipOptions& options)
+    : size(frame_size),
+      logger(logger),
+      options(options),
+      smoother(createTrajectorySmoother(options.smoother, options.smooth_radius)) {
+    CV_Assert(frame_size.width > 0 && frame_size.height > 0);
+    if (!smoother) {
+        CV_Error(cv::Error::StsBadArg, "Неизвестный сглаживатель '" + options.smoother + "'");
+    }
+}
+
+int ClipStabilizer::run(FrameSource& source, FrameSink& sink, const ProgressCallback& progress) {
+    return render(source, sink, analyze(source, progress));
+}
+
+std::vector<FrameTransformation> ClipStabilizer::analyze(FrameSource& source,
+                                                         const ProgressCallback& progress) {
+    std::vector<FrameTransformation> frame_shift_info;
+    MotionEstimator estimator(logger, options.analysis);
+    estimator.setMetrics(metrics);
+    SteadyStateAllocationProbe allocation_probe("анализ", logger);
+    AnalysisOptions frame_options = options.analysis;  // уменьшение меняет бюджет анализа
+    std::unique_ptr<AnalysisBudgetController> budget;
+    if (options.analysis.target_fps > 0.0) {
+        budget = std::make_unique<AnalysisBudgetController>(
+            1.0 / options.analysis.target_fps, estimator.quality(), MAX_ANALYSIS_DOWNSCALE);
+        logger.log(LogLevel::INFO, "Бюджет анализа: ", 1000.0 / options.analysis.target_fps,
+                   " мс на кадр, уровней качества ", budget->levels());
+    }
+    // Цветной предыдущий кадр нужен, чтобы пересчитать его серый при смене уменьшения
+    PingPongFrames frames;
+    PingPongFrames grey_frames;
+    auto read_frame = [&] {
+        ScopedStageTimer timer(metrics, Metrics::Stage::DECODE);
+        if (!source.read(frames.current)) {
+            frames.current.release();
+        }
+    };
+    auto prepare_grey_frame = [&](cv::Mat& grey_frame) {
+        ScopedStageTimer timer(metrics, Metrics::Stage::GRAYSCALE);
+        MotionEstimator::prepareGreyFrame(frames.current, grey_frame, frame_options);
+    };
+    read_frame();
+    prepare_grey_frame(grey_frames.previous);
+    frames.advance();
+
+    int frame_counter = 1;
+
+    while (true) {
+        read_frame();
+
+        if (frames.current.empty()) {
+            logger.log(LogLevel::INFO, "Все фреймы входного видео обработаны! Поиск точек ",
+                       estimator.detectionCount(), " раз на ", frame_counter - 1, " пар кадров");
+            if (budget) {
+                logBudgetReport(logger, *budget);
+            }
+            allocation_probe.report();
+            break;
+        }
+
+        auto analysis_start = std::chrono::steady_clock::now();
+        prepare_grey_frame(grey_frames.current);
+
+        FrameTransformation shift = estimator.estimate(grey_frames.previous, grey_frames.current);
+        frame_shift_info.push_back(shift);
+
+        double analysis_seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - analysis_start)
+                .count();
+        if (budget && budget->onFrame(analysis_seconds)) {
+            logQualityChange(logger, frame_counter, *budget);
+            estimator.setQuality(budget->quality());
+            if (budget->quality().downscale != frame_options.downscale) {
+                // Текущий серый кадр станет предыдущим - он нужен уже в новом масштабе
+                frame_options.downscale = budget->quality().downscale;
+                prepare_grey_frame(grey_frames.current);
+            }
+        }
+
+        grey_frames.advance();
+        frames.advance();
+        allocation_probe.onFrame();
+
+        if (progress) {
+            progress(frame_counter, estimator.trackedPoints());
+        }
+        frame_counter++;
+    }
+
+    return frame_shift_info;
+}
+
+int ClipStabilizer::render(FrameSource& source, FrameSink& sink,
+                           const std::vector<FrameTransformation>& frame_shift_info) {
+    recordFrameShifts(frame_shift_info);
+    std::vector<MotionTrajectory> trajectory = buildTrajectory(frame_shift_info);
+    logger.log(LogLevel::INFO, "Сглаживание траектории: ", smoother->name(), ", радиус ",
+               options.smooth_radius);
+    std::vector<MotionTrajectory> smoothed_trajectory = smoothTrajectory(trajectory);
+
+    double max_diff_x = 0.0;
+    double max_diff_y = 0.0;
+    std::vector<FrameTransformation> new_frame_shift_info =
+        correctShifts(frame_shift_info, smoothed_trajectory, max_diff_x, max_diff_y);
+    chooseCrop(max_diff_x, max_diff_y);
+
+    // Превью показывается из вызывающего потока, поэтому с ним отрисовка последовательная.
+    // По умолчанию потоков столько, сколько у OpenCV: в пакетном режиме это уже доля ядер
+    // на один ролик
+    const int threads = options.render_threads > 0 ? options.render_threads : cv::getNumThreads();
+    source.rewind();
+    if (threads > 1 && !options.preview) {
+        return renderParallel(source, sink, new_frame_shift_info, threads);
+    }
+    return renderSerial(source, sink, new_frame_shift_info);
+}
+
+// Покадровые числа идут в dump, если он задан, иначе - строками в лог
+void ClipStabilizer::recordFrameShifts(const std::vector<FrameTransformation>& frame_shift_info) {
+    for (size_t i = 0; i < frame_shift_info.size(); i++) {
+        const FrameTransformation& shift = frame_shift_info[i];
+        if (trajectoryDump != nullptr) {
+            trajectoryDump->record(TrajectoryDump::Kind::DELTA, i + 1, shift.delta_x,
+                                   shift.delta_y, shift.delta_angle, shift.delta_scale);
+        } else if (logsScale()) {
+            logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Кадр="), i + 1,
+                       LogLiteral(" delta_x="), shift.delta_x, LogLiteral(" delta_y="),
+                       shift.delta_y, LogLiteral(" delta_angle="), shift.delta_angle,
+                       LogLiteral(" delta_scale="), shift.delta_scale);
+        } else {
+            logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Кадр="), i + 1,
+                       LogLiteral(" delta_x="), shift.delta_x, LogLiteral(" delta_y="),
+                       shift.delta_y, LogLiteral(" delta_angle="), shift.delta_angle);
+        }
+    }
+}
+
+std::vector<MotionTrajectory> ClipStabilizer::buildTrajectory(
+    const std::vector<FrameTransformation>& frame_shift_info) {
+    double x = 0;
+    double y = 0;
+    double a = 0;
+    double s = 0;
+    std::vector<MotionTrajectory> trajectory;
+    trajectory.reserve(frame_shift_info.size());
+
+    for (size_t i = 0; i < frame_shift_info.size(); i++) {
+        x += frame_shift_info[i].delta_x;
+        y += frame_shift_info[i].delta_y;
+        a += frame_shift_info[i].delta_angle;
+        s += frame_shift_info[i].delta_scale;
+        trajectory.push_back(MotionTrajectory(x, y, a, s));
+
+        if (trajectoryDump != nullptr) {
+            trajectoryDump->record(TrajectoryDump::Kind::TRAJECTORY, i + 1, x, y, a, s);
+        } else if (logsScale()) {
+            logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Траектория => Кадр:"), i + 1,
+                       LogLiteral(", x="), x, LogLiteral(", y="), y, LogLiteral(", angle="), a,
+                       LogLiteral(", scale="), s);
+        } else {
+            logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Траектория => Кадр:"), i + 1,
+                       LogLiteral(", x="), x, LogLiteral(", y="), y, LogLiteral(", angle="), a);
+        }
+    }
+
+    return trajectory;
+}
+
+std::vector<MotionTrajectory> ClipStabilizer::smoothTrajectory(
+    const std::vector<MotionTrajectory>& trajectory) {
+    // В стадию сглаживания входит только сам сглаживатель, без записи в лог и дамп
+    MotionTrajectorySoA smoothed = timeStage(metrics, Metrics::Stage::SMOOTHING, [&] {
+        return smoother->smooth(MotionTrajectorySoA(trajectory));
+    });
+    std::vector<MotionTrajectory> smoothed_trajectory;
+    smoothed_trajectory.reserve(smoothed.size());
+
+    for (size_t i = 0; i < smoothed.size(); i++) {
+        smoothed_trajectory.push_back(smoothed.at(i));
+
+        if (trajectoryDump != nullptr) {
+            trajectoryDump->record(TrajectoryDump::Kind::SMOOTHED, i + 1, smoothed.position_x[i],
+                                   smoothed.position_y[i], smoothed.angle[i], smoothed.scale[i]);
+        } else if (logsScale()) {
+            logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Сглаженная раектория => Кадр:"),
+                       i + 1, LogLiteral(", avg_x="), smoothed.position_x[i],
+                       LogLiteral(", avg_y="), smoothed.position_y[i], LogLiteral(", avg_angle="),
+                       smoothed.angle[i], LogLiteral(", avg_scale="), smoothed.scale[i]);
+        } else {
+            logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Сглаженная раектория => Кадр:"),
+                       i + 1, LogLiteral(", avg_x="), smoothed.position_x[i],
+                       LogLiteral(", avg_y="), smoothed.position_y[i], LogLiteral(", avg_angle="),
+                       smoothed.angle[i]);
+        }
+    }
+
+    return smoothed_trajectory;
+}
+
+// max_diff_x/max_diff_y - сколько поправки открывают края кадра. Поправка масштаба
+// (similarity) с уменьшением сжимает кадр к левому верхнему углу и открывает правый
+// и нижний края на (1 - e^diff_s) ширины и высоты - это добавляется к сдвигу.
+std::vector<FrameTransformation> ClipStabilizer::correctShifts(
+    const std::vector<FrameTransformation>& frame_shift_info,
+    const std::vector<MotionTrajectory>& smoothed_trajectory, double& max_diff_x,
+    double& max_diff_y) const {
+    std::vector<FrameTransformation> new_frame_shift_info;
+    double x = 0;
+    double y = 0;
+    double a = 0;
+    double s = 0;
+    max_diff_x = 0.0;
+    max_diff_y = 0.0;
+
+    for (size_t i = 0; i < frame_shift_info.size(); i++) {
+        x += frame_shift_info[i].delta_x;
+        y += frame_shift_info[i].delta_y;
+        a += frame_shift_info[i].delta_angle;
+        s += frame_shift_info[i].delta_scale;
+
+        double diff_x = smoothed_trajectory[i].position_x - x;
+        double diff_y = smoothed_trajectory[i].position_y - y;
+        double diff_a = smoothed_trajectory[i].angle - a;
+        double diff_s = smoothed_trajectory[i].scale - s;
+
+        const double shrink = 1.0 - std::exp(std::min(diff_s, 0.0));
+        max_diff_x = std::max(max_diff_x, diff_x + shrink * size.width);
+        max_diff_y = std::max(max_diff_y, diff_y + shrink * size.height);
+
+        double corrected_delta_x = frame_shift_info[i].delta_x + diff_x;
+        double corrected_delta_y = frame_shift_info[i].delta_y + diff_y;
+        double corrected_delta_angle = frame_shift_info[i].delta_angle + diff_a;
+        double corrected_delta_scale = frame_shift_info[i].delta_scale + diff_s;
+
+        new_frame_shift_info.push_back(FrameTransformation(corrected_delta_x, corrected_delta_y,
+                                                           corrected_delta_angle,
+                                                           corrected_delta_scale));
+    }
+
+    return new_frame_shift_info;
+}
+
+void ClipStabilizer::chooseCrop(double max_diff_x, double max_diff_y) {
+    if (options.auto_crop) {
+        if (max_diff_x > max_diff_y) {
+            cropX = static_cast<int>(max_diff_x);
+            cropY = cropX * size.height / size.width;
+        } else {
+            cropY = static_cast<int>(max_diff_y);
+            cropX = cropY * size.width / size.height;
+        }
+    } else {
+        cropY = options.border_crop_pixels;
+        cropX = options.border_crop_pixels * size.width / size.height;
+    }
+
+    logger.log(LogLevel::INFO, "Обрезка кадров выполнена, обрезаем по ширине на ", cropX,
+               " пикселей, по высоте на ", cropY, " пикселей.");
+}
+
+bool ClipStabilizer::renderFrame(const cv::Mat& frame, const FrameTransformation& transformation,
+                                 cv::Mat& stabilized_frame) const {
+    return timeStage(metrics, Metrics::Stage::RENDER, [&] {
+        return renderStabilizedFrame(frame, transformation, cropX, cropY, stabilized_frame,
+                                     options.render_mode, options.analysis.input_format,
+                                     options.chroma_siting);
+    });
+}
+
+int ClipStabilizer::renderSerial(FrameSource& source, FrameSink& sink,
+                                 const std::vector<FrameTransformation>& new_frame_shift_info) {
+    int frame_counter = 0;
+    int frames_written = 0;
+    SteadyStateAllocationProbe allocation_probe("отрисовка", logger);
+    cv::Mat current_frame;
+    cv::Mat current_frame_rehab;
+
+    for (; frame_counter < static_cast<int>(new_frame_shift_info.size()); frame_counter++) {
+        try {
+            bool read = timeStage(metrics, Metrics::Stage::DECODE,
+                                  [&] { return source.read(current_frame); });
+
+            if (!read || current_frame.empty()) {
+                break;
+            }
+
+            if (!renderFrame(current_frame, new_frame_shift_info[frame_counter],
+                             current_frame_rehab)) {
+                logger.log(LogLevel::ERROR,
+                           "Ошибка: Обрезка выходит за границы кадра! Пропускаем кадр.");
+                continue;
+            }
+
+            sink.write(current_frame_rehab);
+            frames_written++;
+            allocation_probe.onFrame();
+
+        } catch (cv::Exception& e) {
+            logger.log(LogLevel::ERROR, "OpenCV Exception: ", e.what(), " на кадре ",
+                       frame_counter);
+        } catch (std::exception& e) {
+            logger.log(LogLevel::ERROR, "Exception: ", e.what(), " на кадре ", frame_counter);
+        } catch (...) {
+            logger.log(LogLevel::ERROR, "Неизвестная ошибка на кадре ", frame_counter);
+        }
+
+        if (options.preview) {
+            showDebugPreview(current_frame, current_frame_rehab, options.analysis.input_format);
+        }
+    }
+
+    allocation_probe.report();
+    logger.log(LogLevel::INFO, "Готово, стабилизированное видео сохранено!");
+    return frames_written;
+}
+
+// Отрисовка в пуле потоков: вызывающий поток только декодирует, кадры пишутся в исходном
+// порядке из потока записи ParallelRenderPass
+int ClipStabilizer::renderParallel(FrameSource& source, FrameSink& sink,
+                                   const std::vector<FrameTransformation>& new_frame_shift_info,
+                                   int threads) {
+    const size_t window = options.render_window > 0
+                              ? options.render_window
+                              : threads + RENDER_WINDOW_EXTRA_FRAMES;
+    logger.log(LogLevel::INFO, "Отрисовка в ", threads, " потоков, кадров в полёте: ", window);
+
+    std::atomic<int> frames_written{0};
+    SteadyStateAllocationProbe allocation_probe("отрисовка", logger);
+    ParallelRenderPass render_pass(
+        threads, window,
+        [&](const cv::Mat& frame, size_t index, cv::Mat& rendered) {
+            return !frame.empty() && renderFrame(frame, new_frame_shift_info[index], rendered);
+        },
+        [&](const cv::Mat& frame, const cv::Mat& rendered, size_t) {
+            if (frame.empty()) {
+                return;  // кадр не прочитался, ошибка уже в логе
+            }
+            if (rendered.empty()) {
+                logger.log(LogLevel::ERROR,
+                           "Ошибка: Обрезка выходит за границы кадра! Пропускаем кадр.");
+                return;
+            }
+            sink.write(rendered);
+            frames_written++;
+        },
+        logger);
+
+    cv::Mat current_frame;
+    for (size_t frame_counter = 0; frame_counter < new_frame_shift_info.size(); frame_counter++) {
+        bool read = false;
+        bool failed = false;
+        try {
+            read = timeStage(metrics, Metrics::Stage::DECODE,
+                             [&] { return source.read(current_frame); });
+        } catch (cv::Exception& e) {
+            logger.log(LogLevel::ERROR, "OpenCV Exception: ", e.what(), " на кадре ",
+                       frame_counter);
+            failed = true;
+        } catch (std::exception& e) {
+            logger.log(LogLevel::ERROR, "Exception: ", e.what(), " на кадре ", frame_counter);
+            failed = true;
+        } catch (...) {
+            logger.log(LogLevel::ERROR, "Неизвестная ошибка на кадре ", frame_counter);
+            failed = true;
+        }
+        // Как в последовательном пути, кадр пропускается, но номер за ним остаётся -
+        // пустой кадр, чтобы поправки следующих кадров не сдвинулись
+        if (failed) {
+            current_frame.release();
+            render_pass.submit(current_frame);
+            continue;
+        }
+        if (!read || current_frame.empty()) {
+            break;
+        }
+        render_pass.submit(current_frame);
+        allocation_probe.onFrame();
+    }
+    render_pass.finish();
+
+    logger.log(LogLevel::INFO, "Декодер ждал отрисовку ", render_pass.submitWaitSeconds(), " с");
+    allocation_probe.report();
+    logger.log(LogLevel::INFO, "Готово, стабилизированное видео сохранено!");
+    return frames_written.load();
+}
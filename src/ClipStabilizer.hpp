@@ -0,0 +1,129 @@
+#ifndef CLIP_STABILIZER_H
+#define CLIP_STABILIZER_H
+
+#include <functional>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "../include/Config.hpp"
+#include "FrameRenderer.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "MotionEstimator.hpp"
+#include "MotionTypes.hpp"
+#include "TrajectoryDump.hpp"
+#include "TrajectorySmoother.hpp"
+
+// Откуда ClipStabilizer берёт кадры. Ролик читается дважды, поэтому источник должен
+// уметь вернуться в начало.
+class FrameSource {
+   public:
+    virtual ~FrameSource() = default;
+
+    // Следующий кадр в frame (буфер переиспользуется); false - кадры кончились.
+    // Исключение - кадр не прочитался: во втором проходе он пропускается, номер за ним остаётся.
+    virtual bool read(cv::Mat& frame) = 0;
+
+    // В начало ролика, перед вторым проходом
+    virtual void rewind() = 0;
+};
+
+// Куда ClipStabilizer пишет стабилизированные кадры: по порядку, всегда из одного потока
+class FrameSink {
+   public:
+    virtual ~FrameSink() = default;
+    virtual void write(const cv::Mat& frame) = 0;
+};
+
+// Всё, что CLI берёт из ключей командной строки, для двухпроходной стабилизации ролика
+struct ClipOptions {
+    AnalysisOptions analysis;  // формат кадров (BGR, I420, NV12) - analysis.input_format
+    std::string smoother = "box";  // box | gaussian | kalman, см. createTrajectorySmoother
+    int smooth_radius = NFRAMES_SMOOTH_COEF;
+    bool auto_crop = false;  // рамка по наибольшей поправке, border_crop_pixels не нужен
+    int border_crop_pixels = DEFAULT_BORDER_CROP_PIXELS;  // по другой оси - в пропорции кадра
+    RenderMode render_mode = RenderMode::FUSED;
+    ChromaSiting chroma_siting = ChromaSiting::LEFT;  // для I420/NV12; MPEG-2, H.264
+    int render_threads = 0;  // 0 - cv::getNumThreads(), 1 - отрисовка в вызывающем потоке
+    int render_window = 0;   // кадров в полёте; 0 - render_threads + RENDER_WINDOW_EXTRA_FRAMES
+    bool preview = false;    // окно сравнения на каждый кадр; отрисовка тогда последовательная
+};
+
+// Двухпроходная стабилизация целого ролика: первый проход оценивает движение, траектория
+// сглаживается целиком (в обе стороны по времени, любым сглаживателем), рамка считается
+// по всем поправкам сразу, второй проход рисует кадры - в пуле потоков, если их больше
+// одного. Как и у Stabilizer, всё состояние - в экземпляре и ClipOptions, без глобальных
+// настроек, так что несколько роликов можно стабилизировать одновременно.
+class ClipStabilizer {
+   public:
+    // (номер кадра, сколько точек отследили)
+    using ProgressCallback = std::function<void(int, size_t)>;
+
+    // frame_size - размер изображения (для I420/NV12 - плоскости Y).
+    // Неизвестный options.smoother - cv::Exception.
+    ClipStabilizer(cv::Size frame_size, Logger& logger, const ClipOptions& options = {});
+
+    // Первый проход: сдвиги между соседними кадрами, последовательно и с бюджетом
+    // analysis.target_fps, если он задан. source читается с текущего места до конца.
+    std::vector<FrameTransformation> analyze(FrameSource& source,
+                                             const ProgressCallback& progress = {});
+
+    // Сглаживание, рамка и второй проход. frame_shift_info - из analyze() или из любого
+    // другого анализа того же ролика (кэш, отрезки, конвейер). source перематывается
+    // в начало. Возвращает число записанных кадров.
+    int render(FrameSource& source, FrameSink& sink,
+               const std::vector<FrameTransformation>& frame_shift_info);
+
+    // analyze() и render() подряд
+    int run(FrameSource& source, FrameSink& sink, const ProgressCallback& progress = {});
+
+    // Декодирование, серый кадр, анализ, сглаживание и отрисовка пишутся в metrics;
+    // nullptr - не писать
+    void setMetrics(Metrics* metrics) { this->metrics = metrics; }
+
+    // Сдвиги и траектории - в dump вместо строк лога; nullptr - в лог
+    void setTrajectoryDump(TrajectoryDump* dump) { trajectoryDump = dump; }
+
+    const ClipOptions& settings() const { return options; }
+    cv::Size frameSize() const { return size; }
+
+    // Рамка последнего render()
+    int currentCropX() const { return cropX; }
+    int currentCropY() const { return cropY; }
+
+   private:
+    // Масштаб в строках лога - только у similarity, у других моделей он всегда 0
+    bool logsScale() const { return options.analysis.motion_model == MotionModel::SIMILARITY; }
+
+    void recordFrameShifts(const std::vector<FrameTransformation>& frame_shift_info);
+    std::vector<MotionTrajectory> buildTrajectory(
+        const std::vector<FrameTransformation>& frame_shift_info);
+    std::vector<MotionTrajectory> smoothTrajectory(
+        const std::vector<MotionTrajectory>& trajectory);
+    std::vector<FrameTransformation> correctShifts(
+        const std::vector<FrameTransformation>& frame_shift_info,
+        const std::vector<MotionTrajectory>& smoothed_trajectory, double& max_diff_x,
+        double& max_diff_y) const;
+    void chooseCrop(double max_diff_x, double max_diff_y);
+
+    int renderSerial(FrameSource& source, FrameSink& sink,
+                     const std::vector<FrameTransformation>& new_frame_shift_info);
+    int renderParallel(FrameSource& source, FrameSink& sink,
+                       const std::vector<FrameTransformation>& new_frame_shift_info,
+                       int threads);
+    bool renderFrame(const cv::Mat& frame, const FrameTransformation& transformation,
+                     cv::Mat& stabilized_frame) const;
+
+    cv::Size size;
+    Logger& logger;
+    ClipOptions options;
+    std::unique_ptr<TrajectorySmoother> smoother;
+    Metrics* metrics = nullptr;
+    TrajectoryDump* trajectoryDump = nullptr;
+    int cropX = 0;
+    int cropY = 0;
+};
+
+#endif  // CLIP_STABILIZER_H
@@ -0,0 +1,56 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Пул кадровых буферов для конвейера: вместо нового cv::Mat на каждый кадр стадия берёт
+// отработавший буфер у пула, а потребитель возвращает его обратно. Буфер того же размера
+// cv::Mat::create() не перевыделяет, так что в установившемся режиме аллокаций нет.
+// Потокобезопасен: берут и возвращают буферы разные стадии.
+class FramePool {
+   public:
+    // Возвращает свободный буфер или пустой cv::Mat, если свободных нет
+    cv::Mat acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (freeFrames.empty()) {
+            missCount++;
+            return cv::Mat();
+        }
+        cv::Mat frame = std::move(freeFrames.back());
+        freeFrames.pop_back();
+        return frame;
+    }
+
+    // frame не должен больше нигде использоваться
+    void release(cv::Mat&& frame) {
+        if (frame.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        freeFrames.push_back(std::move(frame));
+    }
+
+    // Сколько раз пул был пуст - столько буферов пришлось выделить
+    size_t misses() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return missCount;
+    }
+
+   private:
+    mutable std::mutex mutex;
+    std::vector<cv::Mat> freeFrames;
+    size_t missCount = 0;
+};
+
+// Два буфера "предыдущий/текущий" кадр: после обработки пары они меняются местами
+// без копирования, и следующий кадр пишется в освободившийся буфер
+struct PingPongFrames {
+    cv::Mat previous;
+    cv::Mat current;
+
+    void advance() { cv::swap(previous, current); }
+};
+
+#endif  // FRAME_POOL_H
@@ -0,0 +1,189 @@
+#include "FrameRenderer.hpp"
+
+#include <cmath>
+
+#include "../include/Config.hpp"
+#include "AffineWarper.hpp"
+
+cv::Matx23d buildTransformMatrix(const FrameTransformation& transformation) {
+    const double scale = exp(transformation.delta_scale);
+    const double cos_angle = scale * cos(transformation.delta_angle);
+    const double sin_angle = scale * sin(transformation.delta_angle);
+
+    return cv::Matx23d(cos_angle, -sin_angle, transformation.delta_x,  //
+                       sin_angle, cos_angle, transformation.delta_y);
+}
+
+cv::Matx23d buildFusedWarpMatrix(const FrameTransformation& transformation, int crop_x,
+                                 int crop_y, cv::Size frame_size) {
+    // resize (INTER_LINEAR) берёт для выходного пикселя u точку (u + 0.5) * scale - 0.5
+    // вырезанного кадра; вырезка сдвигает её на рамку, warpAffine применяет к ней T^-1
+    double scale_x = static_cast<double>(frame_size.width - 2 * crop_y) / frame_size.width;
+    double scale_y = static_cast<double>(frame_size.height - 2 * crop_x) / frame_size.height;
+    double offset_x = crop_y + 0.5 * scale_x - 0.5;
+    double offset_y = crop_x + 0.5 * scale_y - 0.5;
+
+    cv::Matx23d inv;
+    cv::invertAffineTransform(buildTransformMatrix(transformation), inv);
+
+    cv::Matx23d M;
+    for (int row = 0; row < 2; ++row) {
+        M(row, 0) = inv(row, 0) * scale_x;
+        M(row, 1) = inv(row, 1) * scale_y;
+        M(row, 2) = inv(row, 0) * offset_x + inv(row, 1) * offset_y + inv(row, 2);
+    }
+    return M;
+}
+
+bool cropCoversFrame(const FrameTransformation& transformation, int crop_x, int crop_y,
+                     cv::Size frame_size) {
+    const double EPSILON = 1e-6;
+    const double right = frame_size.width - 1;
+    const double bottom = frame_size.height - 1;
+    cv::Matx23d M = buildFusedWarpMatrix(transformation, crop_x, crop_y, frame_size);
+    for (double u : {0.0, right}) {
+        for (double v : {0.0, bottom}) {
+            double x = M(0, 0) * u + M(0, 1) * v + M(0, 2);
+            double y = M(1, 0) * u + M(1, 1) * v + M(1, 2);
+            if (x < -EPSILON || x > right + EPSILON || y < -EPSILON || y > bottom + EPSILON) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+namespace {
+
+// Отсчёт цветности c 4:2:0 стоит в яркости в точке L = 2c + o, где o - сдвиг по осям:
+// (0.5, 0.5) в центре блока 2x2, (0, 0.5) для MPEG-2, (0, 0) на левом верхнем пикселе.
+// Из src_L = A dst_L + b получаем src_c = A dst_c + (A o + b - o) / 2.
+cv::Matx23d chromaWarpMatrix(const cv::Matx23d& luma, ChromaSiting siting) {
+    const double offset[2] = {siting == ChromaSiting::CENTER ? 0.5 : 0.0,
+                              siting == ChromaSiting::TOP_LEFT ? 0.0 : 0.5};
+    cv::Matx23d chroma = luma;
+    for (int row = 0; row < 2; ++row) {
+        chroma(row, 2) = (luma(row, 0) * offset[0] + luma(row, 1) * offset[1] + luma(row, 2) -
+                          offset[row]) /
+                         2.0;
+    }
+    return chroma;
+}
+
+// Все три плоскости пишутся прямо в stabilized_frame, без промежуточных буферов и BGR.
+// Поля за краем кадра - чёрные: Y = 16, U = V = 128.
+bool renderStabilizedI420(const cv::Mat& frame, const FrameTransformation& transformation,
+                          int crop_x, int crop_y, cv::Mat& stabilized_frame,
+                          ChromaSiting siting) {
+    I420Planes source = splitI420(frame);
+    if (crop_x * 2 >= source.y.rows || crop_y * 2 >= source.y.cols) {
+        return false;
+    }
+
+    stabilized_frame.create(frame.size(), frame.type());
+    I420Planes target = splitI420(stabilized_frame);
+
+    cv::Matx23d luma = buildFusedWarpMatrix(transformation, crop_x, crop_y, source.y.size());
+    cv::Matx23d chroma = chromaWarpMatrix(luma, siting);
+    const int flags = cv::INTER_LINEAR | cv::WARP_INVERSE_MAP;
+    warpAffine(source.y, target.y, luma, source.y.size(), flags, cv::BORDER_CONSTANT,
+               cv::Scalar(16));
+    warpAffine(source.u, target.u, chroma, source.u.size(), flags, cv::BORDER_CONSTANT,
+               cv::Scalar(128));
+    warpAffine(source.v, target.v, chroma, source.v.size(), flags, cv::BORDER_CONSTANT,
+               cv::Scalar(128));
+    return true;
+}
+
+// Как I420, только U и V идут одной двухканальной плоскостью - одна выборка на пару
+bool renderStabilizedNV12(const cv::Mat& frame, const FrameTransformation& transformation,
+                          int crop_x, int crop_y, cv::Mat& stabilized_frame,
+                          ChromaSiting siting) {
+    Nv12Planes source = splitNV12(frame);
+    if (crop_x * 2 >= source.y.rows || crop_y * 2 >= source.y.cols) {
+        return false;
+    }
+
+    stabilized_frame.create(frame.size(), frame.type());
+    Nv12Planes target = splitNV12(stabilized_frame);
+
+    cv::Matx23d luma = buildFusedWarpMatrix(transformation, crop_x, crop_y, source.y.size());
+    const int flags = cv::INTER_LINEAR | cv::WARP_INVERSE_MAP;
+    warpAffine(source.y, target.y, luma, source.y.size(), flags, cv::BORDER_CONSTANT,
+               cv::Scalar(16));
+    warpAffine(source.uv, target.uv, chromaWarpMatrix(luma, siting), source.uv.size(), flags,
+               cv::BORDER_CONSTANT, cv::Scalar(128, 128));
+    return true;
+}
+
+}  // namespace
+
+bool renderStabilizedFrame(const cv::Mat& frame, const FrameTransformation& transformation,
+                           int crop_x, int crop_y, cv::Mat& stabilized_frame, RenderMode mode,
+                           PixelFormat format, ChromaSiting siting) {
+    if (format == PixelFormat::I420) {
+        return renderStabilizedI420(frame, transformation, crop_x, crop_y, stabilized_frame,
+                                    siting);
+    }
+    if (format == PixelFormat::NV12) {
+        return renderStabilizedNV12(frame, transformation, crop_x, crop_y, stabilized_frame,
+                                    siting);
+    }
+
+    if (crop_x * 2 >= frame.rows || crop_y * 2 >= frame.cols) {
+        return false;
+    }
+
+    if (mode == RenderMode::FUSED) {
+        cv::Matx23d M = buildFusedWarpMatrix(transformation, crop_x, crop_y, frame.size());
+        if (frame.type() == CV_8UC3) {
+            AffineWarper::warpBilinear(frame, stabilized_frame, M, frame.size());
+        } else {
+            warpAffine(frame, stabilized_frame, M, frame.size(),
+                       cv::INTER_LINEAR | cv::WARP_INVERSE_MAP);
+        }
+        return true;
+    }
+
+    // Промежуточный кадр свой у каждого потока и живёт между вызовами
+    static thread_local cv::Mat warped_frame;
+    warpAffine(frame, warped_frame, buildTransformMatrix(transformation), frame.size());
+
+    cv::Mat cropped_frame = warped_frame(cv::Range(crop_x, warped_frame.rows - crop_x),
+                                         cv::Range(crop_y, warped_frame.cols - crop_y));
+    resize(cropped_frame, stabilized_frame, frame.size());
+
+    return true;
+}
+
+void showDebugPreview(const cv::Mat& original_frame, const cv::Mat& stabilized_frame,
+                      PixelFormat format) {
+    if (format != PixelFormat::BGR) {
+        const int code =
+            format == PixelFormat::NV12 ? cv::COLOR_YUV2BGR_NV12 : cv::COLOR_YUV2BGR_I420;
+        cv::Mat original_bgr;
+        cv::Mat stabilized_bgr;
+        cv::cvtColor(original_frame, original_bgr, code);
+        if (!stabilized_frame.empty()) {
+            cv::cvtColor(stabilized_frame, stabilized_bgr, code);
+        }
+        showDebugPreview(original_bgr, stabilized_bgr);
+        return;
+    }
+
+    cv::Mat canvas = cv::Mat::zeros(original_frame.rows * 2 + ADDITION_PREVIEW_OFFSET,
+                                    original_frame.cols, original_frame.type());
+    original_frame.copyTo(canvas(cv::Range(0, original_frame.rows), cv::Range::all()));
+    if (!stabilized_frame.empty()) {
+        stabilized_frame.copyTo(canvas(cv::Range(original_frame.rows + ADDITION_PREVIEW_OFFSET,
+                                                 original_frame.rows * 2 + ADDITION_PREVIEW_OFFSET),
+                                       cv::Range::all()));
+    }
+
+    if (canvas.cols > 1920 || canvas.rows > 1080) {
+        resize(canvas, canvas, cv::Size(canvas.cols / 2, canvas.rows / 2));
+    }
+
+    cv::imshow("Difference View: Original (Top) vs Stabilized (Bottom)", canvas);
+    cv::waitKey(20);
+}
@@ -0,0 +1,43 @@
+#ifndef FRAME_RENDERER_H
+#define FRAME_RENDERER_H
+
+#include <opencv2/opencv.hpp>
+
+#include "MotionTypes.hpp"
+#include "YuvFrame.hpp"
+
+enum class RenderMode {
+    THREE_STEP,  // warpAffine в полный кадр -> вырезка рамки -> resize обратно (старый путь)
+    FUSED        // одна выборка на пиксель прямо из исходного кадра
+};
+
+// Матрица 2x3 поворота + сдвига для warpAffine. Матрицы - cv::Matx на стеке,
+// чтобы отрисовка кадра не выделяла память под них
+cv::Matx23d buildTransformMatrix(const FrameTransformation& transformation);
+
+// Обратное отображение (выходной пиксель -> исходный кадр), в котором сразу учтены
+// поворот/сдвиг, обрезка рамки и растяжение обратно до размера кадра
+cv::Matx23d buildFusedWarpMatrix(const FrameTransformation& transformation, int crop_x,
+                                 int crop_y, cv::Size frame_size);
+
+// true - при рамке crop_x/crop_y каждый выходной пиксель берётся изнутри исходного кадра,
+// т.е. чёрных полей нет. Отображение аффинное, поэтому достаточно проверить углы.
+bool cropCoversFrame(const FrameTransformation& transformation, int crop_x, int crop_y,
+                     cv::Size frame_size);
+
+// Поворачивает/сдвигает кадр, обрезает рамку crop_x (по строкам) и crop_y (по столбцам)
+// и растягивает обратно до исходного размера. false - обрезка больше самого кадра.
+// stabilized_frame переиспользуется, если он уже нужного размера.
+// Кадр I420/NV12 отрисовывается по плоскостям в тот же формат и всегда одной выборкой
+// (mode не влияет); siting - где стоят отсчёты цветности, для BGR не важен.
+bool renderStabilizedFrame(const cv::Mat& frame, const FrameTransformation& transformation,
+                           int crop_x, int crop_y, cv::Mat& stabilized_frame,
+                           RenderMode mode = RenderMode::FUSED,
+                           PixelFormat format = PixelFormat::BGR,
+                           ChromaSiting siting = ChromaSiting::LEFT);
+
+// Окно сравнения: исходный кадр сверху, стабилизированный снизу
+void showDebugPreview(const cv::Mat& original_frame, const cv::Mat& stabilized_frame,
+                      PixelFormat format = PixelFormat::BGR);
+
+#endif  // FRAME_RENDERER_H
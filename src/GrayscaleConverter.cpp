@@ -1,6 +1,235 @@
 #include "GrayscaleConverter.hpp"
 
-cv::Mat GrayscaleConverter::convertToGray(const cv::Mat& colorImage) {
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GRAYSCALE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 0.114 / 0.587 / 0.299 scaled to 1 << 14, the sum is exactly 16384 so white stays 255.
+// 14 bits keep every weight below INT16_MAX, which is what _mm_madd_epi16 needs.
+constexpr int GRAY_SHIFT = 14;
+constexpr int GRAY_WEIGHT_B = 1868;
+constexpr int GRAY_WEIGHT_G = 9617;
+constexpr int GRAY_WEIGHT_R = 4899;
+constexpr int MAX_DOWNSCALE_FACTOR = 16;  // block sums stay in uint16_t
+
+using RowKernel = void (*)(const uchar* src, uchar* dst, int width);
+
+void convertRowScalar(const uchar* src, uchar* dst, int width) {
+    for (int x = 0; x < width; ++x, src += 3) {
+        dst[x] = static_cast<uchar>(
+            (GRAY_WEIGHT_B * src[0] + GRAY_WEIGHT_G * src[1] + GRAY_WEIGHT_R * src[2]) >>
+            GRAY_SHIFT);
+    }
+}
+
+#ifdef GRAYSCALE_X86
+
+// Gray for 8 pixels whose channels are already split into 16-bit lanes
+inline __m128i weightedSum8(__m128i b, __m128i g, __m128i r) {
+    const __m128i weights_bg = _mm_set1_epi32((GRAY_WEIGHT_G << 16) | GRAY_WEIGHT_B);
+    const __m128i weights_r0 = _mm_set1_epi32(GRAY_WEIGHT_R);
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(b, g), weights_bg),
+                               _mm_madd_epi16(_mm_unpacklo_epi16(r, zero), weights_r0));
+    __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(b, g), weights_bg),
+                               _mm_madd_epi16(_mm_unpackhi_epi16(r, zero), weights_r0));
+    return _mm_packs_epi32(_mm_srli_epi32(lo, GRAY_SHIFT), _mm_srli_epi32(hi, GRAY_SHIFT));
+}
+
+inline __m128i weightedSum16(__m128i b, __m128i g, __m128i r) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = weightedSum8(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(g, zero),
+                              _mm_unpacklo_epi8(r, zero));
+    __m128i hi = weightedSum8(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(g, zero),
+                              _mm_unpackhi_epi8(r, zero));
+    return _mm_packus_epi16(lo, hi);
+}
+
+// 32 pixels per iteration. Five rounds of byte unpacking turn 96 interleaved BGR bytes into
+// B0 B1 G0 G1 R0 R1 planes (the classic SSE2 deinterleave, no pshufb required).
+void convertRowSSE2(const uchar* src, uchar* dst, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32, src += 96) {
+        __m128i v[6];
+        for (int i = 0; i < 6; ++i) {
+            v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * i));
+        }
+        for (int round = 0; round < 5; ++round) {
+            __m128i n0 = _mm_unpacklo_epi8(v[0], v[3]);
+            __m128i n1 = _mm_unpackhi_epi8(v[0], v[3]);
+            __m128i n2 = _mm_unpacklo_epi8(v[1], v[4]);
+            __m128i n3 = _mm_unpackhi_epi8(v[1], v[4]);
+            __m128i n4 = _mm_unpacklo_epi8(v[2], v[5]);
+            __m128i n5 = _mm_unpackhi_epi8(v[2], v[5]);
+            v[0] = n0;
+            v[1] = n1;
+            v[2] = n2;
+            v[3] = n3;
+            v[4] = n4;
+            v[5] = n5;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), weightedSum16(v[0], v[2], v[4]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x + 16),
+                         weightedSum16(v[1], v[3], v[5]));
+    }
+    convertRowScalar(src, dst + x, width - x);
+}
+
+// 4 pixels per 128-bit lane: pshufb widens B,G pairs and R to 16 bit, madd does the dot product.
+__attribute__((target("avx2"))) inline __m256i weightedSumAVX2(const uchar* src) {
+    const __m256i shuffle_bg = _mm256_setr_epi8(
+        0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1,  //
+        0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1);
+    const __m256i shuffle_r = _mm256_setr_epi8(
+        2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1,  //
+        2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+    const __m256i weights_bg = _mm256_set1_epi32((GRAY_WEIGHT_G << 16) | GRAY_WEIGHT_B);
+    const __m256i weights_r0 = _mm256_set1_epi32(GRAY_WEIGHT_R);
+
+    __m256i pixels = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12)), 1);
+    __m256i sum =
+        _mm256_add_epi32(_mm256_madd_epi16(_mm256_shuffle_epi8(pixels, shuffle_bg), weights_bg),
+                         _mm256_madd_epi16(_mm256_shuffle_epi8(pixels, shuffle_r), weights_r0));
+    return _mm256_srli_epi32(sum, GRAY_SHIFT);
+}
+
+// 16 pixels per iteration. Each 128-bit load reads 4 bytes past the 12 it uses, so the loop
+// stops 2 pixels early and the scalar tail takes the rest.
+__attribute__((target("avx2"))) void convertRowAVX2(const uchar* src, uchar* dst, int width) {
+    int x = 0;
+    for (; x + 18 <= width; x += 16, src += 48) {
+        __m256i words = _mm256_packs_epi32(weightedSumAVX2(src), weightedSumAVX2(src + 24));
+        words = _mm256_permute4x64_epi64(words, 0xD8);
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words),
+                                         _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), bytes);
+    }
+    convertRowScalar(src, dst + x, width - x);
+}
+
+#endif  // GRAYSCALE_X86
+
+RowKernel selectKernel(GrayscaleConverter::Path path) {
+    switch (path) {
+#ifdef GRAYSCALE_X86
+        case GrayscaleConverter::Path::SSE2:
+            return convertRowSSE2;
+        case GrayscaleConverter::Path::AVX2:
+            return convertRowAVX2;
+#endif
+        default:
+            return convertRowScalar;
+    }
+}
+
+}  // namespace
+
+cv::Mat GrayscaleConverter::convertToGray(const cv::Mat& colorImage, Path path) {
+    cv::Mat grayImage;
+    convertToGray(colorImage, grayImage, path);
+    return grayImage;
+}
+
+void GrayscaleConverter::convertToGray(const cv::Mat& colorImage, cv::Mat& grayImage,
+                                       Path path) {
+    if (colorImage.empty()) {
+        throw std::runtime_error("ERROR: empty imput image!");
+    }
+    if (colorImage.type() != CV_8UC3) {
+        throw std::runtime_error("ERROR: expected 8-bit BGR image!");
+    }
+
+    if (path == Path::AUTO) {
+        path = bestAvailablePath();
+    } else if (!isPathSupported(path)) {
+        throw std::runtime_error(std::string("ERROR: unsupported grayscale path ") +
+                                 pathName(path));
+    }
+
+    grayImage.create(colorImage.rows, colorImage.cols, CV_8UC1);  // no-op if already allocated
+    const RowKernel kernel = selectKernel(path);
+
+    // Rows are addressed through ptr(), so ROI and other non-continuous inputs work as is
+    cv::parallel_for_(cv::Range(0, colorImage.rows), [&](const cv::Range& rows) {
+        for (int y = rows.start; y < rows.end; ++y) {
+            kernel(colorImage.ptr<uchar>(y), grayImage.ptr<uchar>(y), colorImage.cols);
+        }
+    });
+}
+
+void GrayscaleConverter::convertToGrayDownscaled(const cv::Mat& colorImage, cv::Mat& grayImage,
+                                                 int factor, Path path) {
+    if (factor <= 1) {
+        convertToGray(colorImage, grayImage, path);
+        return;
+    }
+    if (factor > MAX_DOWNSCALE_FACTOR) {
+        throw std::runtime_error("ERROR: grayscale downscale factor is too large!");
+    }
+    if (colorImage.empty() || colorImage.type() != CV_8UC3) {
+        throw std::runtime_error("ERROR: expected 8-bit BGR image!");
+    }
+    if (colorImage.rows < factor || colorImage.cols < factor) {
+        throw std::runtime_error("ERROR: image is smaller than the downscale factor!");
+    }
+
+    if (path == Path::AUTO) {
+        path = bestAvailablePath();
+    } else if (!isPathSupported(path)) {
+        throw std::runtime_error(std::string("ERROR: unsupported grayscale path ") +
+                                 pathName(path));
+    }
+    const RowKernel kernel = selectKernel(path);
+    const int out_cols = colorImage.cols / factor;
+    const int block_area = factor * factor;
+
+    grayImage.create(colorImage.rows / factor, out_cols, CV_8UC1);
+
+    cv::parallel_for_(cv::Range(0, grayImage.rows), [&](const cv::Range& rows) {
+        // Per-thread scratch that outlives the call: it only grows, so steady-state frames
+        // of the same size allocate nothing
+        static thread_local std::vector<uchar> gray_row;
+        static thread_local std::vector<uint16_t> block_sums;  // 16 * 16 * 255 fits
+        if (gray_row.size() < static_cast<size_t>(colorImage.cols)) {
+            gray_row.resize(colorImage.cols);
+        }
+        if (block_sums.size() < static_cast<size_t>(out_cols)) {
+            block_sums.resize(out_cols);
+        }
+
+        for (int y = rows.start; y < rows.end; ++y) {
+            std::fill(block_sums.begin(), block_sums.begin() + out_cols, 0);
+            for (int dy = 0; dy < factor; ++dy) {
+                kernel(colorImage.ptr<uchar>(y * factor + dy), gray_row.data(), colorImage.cols);
+                const uchar* src = gray_row.data();
+                for (int x = 0; x < out_cols; ++x) {
+                    int sum = 0;
+                    for (int dx = 0; dx < factor; ++dx) {
+                        sum += *src++;
+                    }
+                    block_sums[x] = static_cast<uint16_t>(block_sums[x] + sum);
+                }
+            }
+
+            uchar* dst = grayImage.ptr<uchar>(y);
+            for (int x = 0; x < out_cols; ++x) {
+                dst[x] = static_cast<uchar>((block_sums[x] + block_area / 2) / block_area);
+            }
+        }
+    });
+}
+
+cv::Mat GrayscaleConverter::convertToGrayReference(const cv::Mat& colorImage) {
     if (colorImage.empty()) {
         throw std::runtime_error("ERROR: empty imput image!");
     }
@@ -21,3 +250,40 @@ cv::Mat GrayscaleConverter::convertToGray(const cv::Mat& colorImage) {
     }
     return grayImage;
 }
+
+GrayscaleConverter::Path GrayscaleConverter::bestAvailablePath() {
+    static const Path best = isPathSupported(Path::AVX2)   ? Path::AVX2
+                             : isPathSupported(Path::SSE2) ? Path::SSE2
+                                                           : Path::SCALAR;
+    return best;
+}
+
+bool GrayscaleConverter::isPathSupported(Path path) {
+    switch (path) {
+        case Path::AUTO:
+        case Path::SCALAR:
+            return true;
+#ifdef GRAYSCALE_X86
+        case Path::SSE2:
+            return cv::checkHardwareSupport(CV_CPU_SSE2);
+        case Path::AVX2:
+            return cv::checkHardwareSupport(CV_CPU_AVX2);
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* GrayscaleConverter::pathName(Path path) {
+    switch (path) {
+        case Path::AUTO:
+            return "auto";
+        case Path::SCALAR:
+            return "scalar";
+        case Path::SSE2:
+            return "sse2";
+        case Path::AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
@@ -3,9 +3,30 @@
 
 #include <opencv2/opencv.hpp>
 
+// BGR -> gray in 14-bit fixed point. All SIMD paths are bit-exact with the scalar fixed-point
+// path; against the legacy double path (convertToGrayReference) the result differs by at most
+// 1 gray level (rounding of the weights 0.114/0.587/0.299 to 1/16384 steps).
 class GrayscaleConverter {
    public:
-    static cv::Mat convertToGray(const cv::Mat& colorImage);
+    enum class Path { AUTO, SCALAR, SSE2, AVX2 };
+
+    static cv::Mat convertToGray(const cv::Mat& colorImage, Path path = Path::AUTO);
+    static void convertToGray(const cv::Mat& colorImage, cv::Mat& grayImage,
+                              Path path = Path::AUTO);
+
+    // Gray image `factor` times smaller on each axis: every output pixel is the mean of a
+    // factor x factor block. Rows are converted with the SIMD kernel and box-summed while they
+    // are still in cache, so the full-resolution gray image is never materialized.
+    // Trailing rows/columns that do not fill a whole block are dropped. factor is 1..16.
+    static void convertToGrayDownscaled(const cv::Mat& colorImage, cv::Mat& grayImage,
+                                        int factor, Path path = Path::AUTO);
+
+    // Old per-pixel double implementation, kept as the reference for benchmarks
+    static cv::Mat convertToGrayReference(const cv::Mat& colorImage);
+
+    static Path bestAvailablePath();
+    static bool isPathSupported(Path path);
+    static const char* pathName(Path path);
 };
 
 #endif  // GRAYSCALE_CONVERTER_H
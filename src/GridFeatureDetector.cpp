@@ -0,0 +1,152 @@
+#include "GridFeatureDetector.hpp"
+
+#include <algorithm>
+
+GridFeatureDetector::GridFeatureDetector(int cols, int rows)
+    : cols(std::max(cols, 1)), rows(std::max(rows, 1)) {}
+
+void GridFeatureDetector::layoutTiles(cv::Size frame_size) {
+    frameSize = frame_size;
+    tileCols = std::clamp(frame_size.width / FEATURE_GRID_MIN_TILE_PX, 1, cols);
+    tileRows = std::clamp(frame_size.height / FEATURE_GRID_MIN_TILE_PX, 1, rows);
+
+    tiles.resize(static_cast<size_t>(tileCols) * tileRows);
+    for (int r = 0; r < tileRows; ++r) {
+        for (int c = 0; c < tileCols; ++c) {
+            const int x0 = frame_size.width * c / tileCols;
+            const int x1 = frame_size.width * (c + 1) / tileCols;
+            const int y0 = frame_size.height * r / tileRows;
+            const int y1 = frame_size.height * (r + 1) / tileRows;
+            tiles[r * tileCols + c].rect = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+        }
+    }
+}
+
+namespace {
+
+// cornersQuality у goodFeaturesToTrack появился в OpenCV 4.5.3. В старых версиях качество
+// точки - тот же cornerMinEigenVal, что goodFeaturesToTrack считает внутри (blockSize 3,
+// как по умолчанию), взятый в самой точке: точки он отдаёт в целых пикселях.
+void detectTileCorners(const cv::Mat& tile_image, int limit, double quality_level,
+                       double min_distance, const cv::Mat& tile_mask,
+                       std::vector<cv::Point2f>& corners, std::vector<float>& quality,
+                       cv::Mat& eigen) {
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR > 5) || \
+    (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 3)
+    (void)eigen;
+    goodFeaturesToTrack(tile_image, corners, limit, quality_level, min_distance, tile_mask,
+                        quality);
+#else
+    goodFeaturesToTrack(tile_image, corners, limit, quality_level, min_distance, tile_mask);
+    cornerMinEigenVal(tile_image, eigen, 3);
+    quality.clear();
+    for (const auto& corner : corners) {
+        quality.push_back(eigen.at<float>(cvRound(corner.y), cvRound(corner.x)));
+    }
+#endif
+}
+
+}  // namespace
+
+size_t GridFeatureDetector::tileIndex(const cv::Point2f& point) const {
+    const int c = std::clamp(static_cast<int>(point.x * tileCols / frameSize.width), 0,
+                             tileCols - 1);
+    const int r = std::clamp(static_cast<int>(point.y * tileRows / frameSize.height), 0,
+                             tileRows - 1);
+    return static_cast<size_t>(r) * tileCols + c;
+}
+
+// В своём тайле min_distance соблюдает goodFeaturesToTrack, а у границы тайлов точки
+// соседей могут оказаться ближе - проверяем по уже принятым новым точкам. Старые точки
+// отсекает mask вызывающего.
+bool GridFeatureDetector::isFarFromAccepted(const cv::Point2f& point, double min_distance,
+                                            size_t first_new,
+                                            const std::vector<cv::Point2f>& keypoints) const {
+    const double min_distance_sq = min_distance * min_distance;
+    for (size_t i = first_new; i < keypoints.size(); ++i) {
+        const cv::Point2f diff = keypoints[i] - point;
+        if (static_cast<double>(diff.x) * diff.x + static_cast<double>(diff.y) * diff.y <
+            min_distance_sq) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void GridFeatureDetector::detect(const cv::Mat& grey_frame, int max_points, double quality_level,
+                                 double min_distance, const cv::Mat& mask,
+                                 std::vector<cv::Point2f>& keypoints) {
+    const size_t wanted = static_cast<size_t>(std::max(max_points, 0));
+    if (grey_frame.empty() || keypoints.size() >= wanted) {
+        return;
+    }
+    if (grey_frame.size() != frameSize) {
+        layoutTiles(grey_frame.size());
+    }
+
+    const int tile_count = static_cast<int>(tiles.size());
+    const int fair_share = (max_points + tile_count - 1) / tile_count;
+    const int tile_limit = fair_share * FEATURE_GRID_TILE_OVERSHOOT;
+
+    for (auto& tile : tiles) {
+        tile.taken = 0;
+        tile.next = 0;
+        tile.corners.clear();
+        tile.quality.clear();
+    }
+    for (const auto& point : keypoints) {
+        tiles[tileIndex(point)].taken++;
+    }
+
+    // Тайл - вид на кадр без копирования; cornerMinEigenVal у края тайла берёт пиксели
+    // соседей, так что швов между тайлами нет
+    cv::parallel_for_(cv::Range(0, tile_count), [&](const cv::Range& range) {
+        for (int t = range.start; t < range.end; ++t) {
+            Tile& tile = tiles[t];
+            const int limit = tile_limit - tile.taken;
+            if (limit <= 0) {
+                continue;
+            }
+            detectTileCorners(grey_frame(tile.rect), limit, quality_level, min_distance,
+                              mask.empty() ? cv::Mat() : mask(tile.rect), tile.corners,
+                              tile.quality, tile.eigen);
+            for (auto& corner : tile.corners) {
+                corner.x += static_cast<float>(tile.rect.x);
+                corner.y += static_cast<float>(tile.rect.y);
+            }
+        }
+    });
+
+    float best_quality = 0.0f;
+    for (const auto& tile : tiles) {
+        if (!tile.quality.empty()) {
+            best_quality = std::max(best_quality, tile.quality.front());
+        }
+    }
+    const float min_quality = static_cast<float>(quality_level) * best_quality;
+
+    // По кругу: на круге level точку берут только тайлы, в которых точек не больше level,
+    // так что сначала добираются тайлы, где отслеживаемых точек мало
+    const size_t first_new = keypoints.size();
+    bool candidates_left = true;
+    for (int level = 0; candidates_left && keypoints.size() < wanted; ++level) {
+        candidates_left = false;
+        for (auto& tile : tiles) {
+            while (tile.taken <= level && tile.next < tile.corners.size()) {
+                const size_t k = tile.next++;
+                if (tile.quality[k] < min_quality) {
+                    tile.next = tile.corners.size();  // дальше только слабее
+                    break;
+                }
+                if (isFarFromAccepted(tile.corners[k], min_distance, first_new, keypoints)) {
+                    keypoints.push_back(tile.corners[k]);
+                    tile.taken++;
+                }
+            }
+            if (keypoints.size() >= wanted) {
+                return;
+            }
+            candidates_left = candidates_left || tile.next < tile.corners.size();
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef GRID_FEATURE_DETECTOR_H
+#define GRID_FEATURE_DETECTOR_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "../include/Config.hpp"
+
+// Поиск точек для отслеживания по сетке тайлов. Кадр режется на cols x rows тайлов,
+// goodFeaturesToTrack работает в каждом тайле параллельно (cv::parallel_for_), а точки
+// разбираются по кругу: каждый тайл отдаёт по одной лучшей точке за круг, пока не набрано
+// нужное число. Так один текстурный участок не забирает все точки, и RANSAC получает
+// точки по всему кадру; пустые (однотонные) тайлы отдают свою долю остальным.
+//
+// Порог качества общий для всего кадра, как у одного вызова goodFeaturesToTrack:
+// точки слабее quality_level * (лучшая точка кадра) отбрасываются, даже если в своём
+// тайле они лучшие.
+class GridFeatureDetector {
+   public:
+    GridFeatureDetector(int cols = FEATURE_GRID_COLS, int rows = FEATURE_GRID_ROWS);
+
+    // Дописывает в keypoints новые точки, пока их не станет max_points. Точки, уже
+    // лежащие в keypoints, засчитываются своим тайлам; mask (может быть пустой) - где
+    // искать можно, как в goodFeaturesToTrack
+    void detect(const cv::Mat& grey_frame, int max_points, double quality_level,
+                double min_distance, const cv::Mat& mask, std::vector<cv::Point2f>& keypoints);
+
+   private:
+    struct Tile {
+        cv::Rect rect;
+        std::vector<cv::Point2f> corners;  // по убыванию качества, в координатах кадра
+        std::vector<float> quality;
+        cv::Mat eigen;                     // карта cornerMinEigenVal, только OpenCV < 4.5.3
+        size_t next = 0;                   // первая ещё не разобранная точка
+        int taken = 0;                     // точек тайла в keypoints
+    };
+
+    void layoutTiles(cv::Size frame_size);
+    size_t tileIndex(const cv::Point2f& point) const;
+    bool isFarFromAccepted(const cv::Point2f& point, double min_distance,
+                           size_t first_new, const std::vector<cv::Point2f>& keypoints) const;
+
+    int cols;
+    int rows;
+    cv::Size frameSize;
+    int tileCols = 0;  // на маленьком кадре тайлов меньше, чем cols x rows
+    int tileRows = 0;
+    std::vector<Tile> tiles;
+};
+
+#endif  // GRID_FEATURE_DETECTOR_H
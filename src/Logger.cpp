@@ -1,34 +1,182 @@
 #include "Logger.hpp"
 
-Logger::Logger(const std::string& log_filename) {
+#include <chrono>
+#include <cstring>
+
+#include "../include/Config.hpp"
+
+Logger::Logger(const std::string& log_filename, bool echo_to_console)
+    : echoToConsole(echo_to_console), ring(LOGGER_RING_CAPACITY) {
     logFile.open(log_filename, std::ios::out);  // В режиме перезаписи
     if (!logFile) {
         std::cerr << "Error: cannot open file for logs!" << std::endl;
     }
+    writer = std::thread([this] { writerLoop(); });
 }
 
 Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wakeWriter.notify_one();
+    writer.join();
+
     if (logFile.is_open()) {
         logFile.close();
     }
 }
 
-void Logger::log(LogLevel level, const std::string& message) {
-    std::string logEntry = getTimeStamp() + " [" + levelToString(level) + "] " + message;
+Logger::Argument* Logger::nextArgument(Record& record) {
+    if (record.argumentCount >= MAX_ARGUMENTS - 1) {
+        return nullptr;
+    }
+    return &record.arguments[record.argumentCount++];
+}
+
+void Logger::appendText(Record& record, const char* data, size_t length) {
+    size_t room = TEXT_BYTES - record.textUsed;
+    if (length > room) {
+        length = room;
+        record.truncated = true;
+    }
+
+    Argument* argument = nextArgument(record);
+    if (argument == nullptr) {
+        // Хвост: один текстовый аргумент в последнем слоте, его текст всегда в конце буфера
+        argument = &record.arguments[MAX_ARGUMENTS - 1];
+        if (record.argumentCount < MAX_ARGUMENTS) {
+            record.argumentCount = MAX_ARGUMENTS;
+            argument->kind = Argument::Kind::TEXT;
+            argument->text = {record.textUsed, 0};
+        }
+        argument->text.length = static_cast<uint16_t>(argument->text.length + length);
+    } else {
+        argument->kind = Argument::Kind::TEXT;
+        argument->text = {record.textUsed, static_cast<uint16_t>(length)};
+    }
+
+    std::memcpy(record.text + record.textUsed, data, length);
+    record.textUsed = static_cast<uint16_t>(record.textUsed + length);
+}
+
+void Logger::writeArgument(std::ostream& out, const Record& record, const Argument& argument) {
+    switch (argument.kind) {
+        case Argument::Kind::LITERAL:
+            out << argument.literal;
+            break;
+        case Argument::Kind::TEXT:
+            out.write(record.text + argument.text.offset, argument.text.length);
+            break;
+        case Argument::Kind::SIGNED:
+            out << argument.signed_value;
+            break;
+        case Argument::Kind::UNSIGNED:
+            out << argument.unsigned_value;
+            break;
+        case Argument::Kind::REAL:
+            out << argument.real_value;
+            break;
+    }
+}
+
+void Logger::submit(const Record& record) {
+    size_t position = 0;
+    while (!ring.tryPush(record, position)) {
+        // Кольцо полно - писатель отстал; будим его и ждём места, но записи не теряем
+        wakeWriter.notify_one();
+        std::this_thread::yield();
+    }
+
+    // Ждём именно свою запись: счётчик "передано" мог бы опередить кольцо, и запись
+    // соседнего потока засчиталась бы вместо нашей
+    if (echoToConsole && record.level != LogLevel::TO_FILE_ONLY) {
+        waitWritten(position + 1);
+    }
+}
+
+void Logger::flush() { waitWritten(ring.claimed()); }
+
+void Logger::waitWritten(uint64_t count) {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    wakeWriter.notify_one();
+    batchWritten.wait(lock, [&] { return written.load(std::memory_order_acquire) >= count; });
+}
+
+void Logger::writerLoop() {
+    while (true) {
+        if (drainBatch() > 0) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        if (stopping) {
+            lock.unlock();
+            if (drainBatch() == 0) {
+                return;
+            }
+            continue;
+        }
+        wakeWriter.wait_for(lock, std::chrono::milliseconds(LOGGER_IDLE_WAIT_MS));
+    }
+}
+
+// Забирает всё, что есть в кольце, и пишет одним куском в файл и одним - в консоль
+size_t Logger::drainBatch() {
+    std::string file_batch;
+    std::string console_batch;
+    size_t records = 0;
+    Record record;
+
+    while (ring.tryPop(record)) {
+        if (record.time != cachedTime) {
+            cachedTime = record.time;
+            cachedTimeStamp = getTimeStamp(record.time);
+        }
+
+        formatBuffer.str(std::string());
+        formatBuffer << cachedTimeStamp << " [" << levelToString(record.level) << "] ";
+        for (uint8_t i = 0; i < record.argumentCount; i++) {
+            writeArgument(formatBuffer, record, record.arguments[i]);
+        }
+        if (record.truncated) {
+            formatBuffer << "...";
+        }
+        formatBuffer << '\n';
+
+        const std::string line = formatBuffer.str();
+        file_batch += line;
+        if (echoToConsole && record.level != LogLevel::TO_FILE_ONLY) {
+            console_batch += line;
+        }
+        records++;
+    }
+
+    if (records == 0) {
+        return 0;
+    }
 
     if (logFile.is_open()) {
-        logFile << logEntry << std::endl;
+        logFile << file_batch;
+        logFile.flush();
+    }
+    if (!console_batch.empty()) {
+        std::cout << console_batch << std::flush;
     }
 
-    if (level != LogLevel::TO_FILE_ONLY) {
-        std::cout << logEntry << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        written.fetch_add(records, std::memory_order_release);
     }
+    batchWritten.notify_all();
+    return records;
 }
 
-std::string Logger::getTimeStamp() {
-    std::time_t now = std::time(nullptr);
+std::string Logger::getTimeStamp(std::time_t time) {
+    std::tm local_time{};
+    localtime_r(&time, &local_time);
     char buffer[20];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local_time);
     return buffer;
 }
 
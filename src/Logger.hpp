@@ -1,35 +1,182 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <ctime>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
+
+#include "MpscRingBuffer.hpp"
 
 enum class LogLevel { INFO, WARNING, ERROR, TO_FILE_ONLY };
 
+// Строковый литерал, который логгер хранит указателем, без копирования текста. Обёртка
+// явная, потому что по типу литерал не отличить от массива char на стеке: оборачивать
+// можно только то, что живёт всю программу. Нужна в покадровых строках лога.
+struct LogLiteral {
+    template <size_t N>
+    constexpr explicit LogLiteral(const char (&literal)[N]) : text(literal), length(N - 1) {}
+
+    const char* text;
+    size_t length;
+};
+
+// Асинхронный логгер. log() ничего не форматирует: аргументы складываются в запись
+// фиксированного размера (LogLiteral - указателем, числа - как есть, прочие строки -
+// копией во встроенный буфер) и кладутся в кольцо без блокировок. Фоновый поток форматирует
+// записи и пишет их пачками, файл сбрасывается один раз на пачку.
+// Строки, которые видны в консоли (всё, кроме TO_FILE_ONLY), log() дожидается, чтобы они
+// не перемешались с прогрессом и прочим выводом в std::cout.
 class Logger {
    public:
-    explicit Logger(const std::string& filename);
+    // echo_to_console = false - всё только в файл (логи роликов в пакетном режиме)
+    explicit Logger(const std::string& filename, bool echo_to_console = true);
     ~Logger();
 
-    void log(LogLevel level, const std::string& message);
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    void log(LogLevel level, const std::string& message) { log<std::string>(level, message); }
 
     template <typename T, typename... Args>
     void log(LogLevel level, const T& first, const Args&... args) {
-        std::ostringstream oss;
-        oss << first;
-        if constexpr (sizeof...(args) > 0) {
-            (oss << ... << args);
-        }
-        log(level, oss.str());
+        Record record;
+        record.time = std::time(nullptr);
+        record.level = level;
+        append(record, first);
+        (append(record, args), ...);
+        submit(record);
     }
 
+    // Ждёт, пока всё, что уже передано в log(), окажется в файле
+    void flush();
+
    private:
-    std::ofstream logFile;
-    std::string getTimeStamp();
+    static constexpr size_t MAX_ARGUMENTS = 16;
+    static constexpr size_t TEXT_BYTES = 512;
+
+    struct Argument {
+        enum class Kind : uint8_t { LITERAL, TEXT, SIGNED, UNSIGNED, REAL };
+        Kind kind;
+        union {
+            const char* literal;
+            int64_t signed_value;
+            uint64_t unsigned_value;
+            double real_value;
+            struct {
+                uint16_t offset;
+                uint16_t length;
+            } text;
+        };
+    };
+
+    struct Record {
+        std::time_t time = 0;
+        LogLevel level = LogLevel::INFO;
+        uint8_t argumentCount = 0;
+        uint16_t textUsed = 0;
+        bool truncated = false;
+        Argument arguments[MAX_ARGUMENTS];
+        char text[TEXT_BYTES];
+    };
+
+    // Последний слот аргументов - "хвост": если слоты кончились, всё дальше дописывается
+    // в него текстом.
+    template <typename T>
+    static void append(Record& record, const T& value) {
+        if constexpr (std::is_same_v<T, LogLiteral>) {
+            Argument* argument = nextArgument(record);
+            if (argument != nullptr) {
+                argument->kind = Argument::Kind::LITERAL;
+                argument->literal = value.text;
+            } else {
+                appendText(record, value.text, value.length);
+            }
+        } else if constexpr (std::is_array_v<T>) {
+            // Массив char (в том числе литерал без LogLiteral) - копией, до первого нуля
+            static_assert(std::is_same_v<std::remove_extent_t<T>, char>);
+            appendText(record, value, strnlen(value, std::extent_v<T>));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            appendText(record, value.data(), value.size());
+        } else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+            appendText(record, value, std::char_traits<char>::length(value));
+        } else if constexpr (std::is_same_v<T, char>) {
+            appendText(record, &value, 1);
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            appendNumber(record, Argument::Kind::SIGNED, [&](Argument& a) {
+                a.signed_value = static_cast<int64_t>(value);
+            });
+        } else if constexpr (std::is_integral_v<T>) {
+            appendNumber(record, Argument::Kind::UNSIGNED, [&](Argument& a) {
+                a.unsigned_value = static_cast<uint64_t>(value);
+            });
+        } else if constexpr (std::is_floating_point_v<T>) {
+            appendNumber(record, Argument::Kind::REAL,
+                         [&](Argument& a) { a.real_value = static_cast<double>(value); });
+        } else {
+            // Редкие типы с собственным operator<< - форматируем сразу
+            std::ostringstream oss;
+            oss << value;
+            const std::string formatted = oss.str();
+            appendText(record, formatted.data(), formatted.size());
+        }
+    }
+
+    template <typename Setter>
+    static void appendNumber(Record& record, typename Argument::Kind kind, Setter set) {
+        Argument* argument = nextArgument(record);
+        if (argument != nullptr) {
+            argument->kind = kind;
+            set(*argument);
+            return;
+        }
+        // Аргументы кончились - дописываем текстом
+        Argument overflow{};
+        overflow.kind = kind;
+        set(overflow);
+        std::ostringstream oss;
+        writeArgument(oss, record, overflow);
+        const std::string formatted = oss.str();
+        appendText(record, formatted.data(), formatted.size());
+    }
+
+    static Argument* nextArgument(Record& record);
+    static void appendText(Record& record, const char* data, size_t length);
+    static void writeArgument(std::ostream& out, const Record& record, const Argument& argument);
+
+    void submit(const Record& record);
+    // Ждёт, пока фоновый поток запишет первые count записей кольца
+    void waitWritten(uint64_t count);
+    void writerLoop();
+    size_t drainBatch();
+
+    std::string getTimeStamp(std::time_t time);
     std::string levelToString(LogLevel level);
+
+    std::ofstream logFile;
+    bool echoToConsole;
+
+    MpscRingBuffer<Record> ring;
+    std::atomic<uint64_t> written{0};
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeWriter;
+    std::condition_variable batchWritten;
+    bool stopping = false;
+
+    // Состояние фонового потока
+    std::ostringstream formatBuffer;
+    std::time_t cachedTime = -1;
+    std::string cachedTimeStamp;
+    std::thread writer;
 };
 
 #endif  // LOGGER_H
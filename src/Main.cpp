@@ -1,53 +1,67 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 #include <cmath>
+#include <filesystem>
+#include <memory>
 #include <opencv2/opencv.hpp>
+#include <thread>
 
 #include "../include/Config.hpp"
-#include "GrayscaleConverter.hpp"
+#include "AllocationCounter.hpp"
+#include "AnalysisBudgetController.hpp"
+#include "AnalysisCache.hpp"
+#include "AnalysisPipeline.hpp"
+#include "BatchScheduler.hpp"
+#include "BoundedQueue.hpp"
+#include "ChunkedAnalyzer.hpp"
+#include "ClipStabilizer.hpp"
+#include "FramePool.hpp"
+#include "FrameRenderer.hpp"
 #include "Logger.hpp"
+#include "Metrics.hpp"
+#include "MotionEstimator.hpp"
+#include "MotionTypes.hpp"
+#include "Stabilizer.hpp"
+#include "TrajectoryDump.hpp"
+#include "TrajectorySmoother.hpp"
+#include "YuvVideo.hpp"
 
 bool AUTO_BORDER_CROP_PIXELS = false;
 int BORDER_CROP_PIXELS = DEFAULT_BORDER_CROP_PIXELS;
+bool BORDER_CROP_PIXELS_SET = false;  // задано явно - в живом режиме рамка не адаптивная
 bool DEBUG = false;
-
-struct VideoInfo {
-    double frame_width;
-    double frame_height;
-    double frame_rate;
-    double total_frames;
-    double duration;
-
-    void print() const {
-        std::cout << "Информация о видео:" << std::endl;
-        std::cout << "  Разрешение: " << frame_width << "x" << frame_height << std::endl;
-        std::cout << "  Частота кадров: " << frame_rate << " FPS" << std::endl;
-        std::cout << "  Количество кадров: " << total_frames << std::endl;
-        std::cout << "  Длительность: " << duration << " секунд" << std::endl;
-    }
-};
-
-struct FrameTransformation {
-    FrameTransformation() {}
-    FrameTransformation(double shift_x, double shift_y, double rotation_angle) {
-        delta_x = shift_x;
-        delta_y = shift_y;
-        delta_angle = rotation_angle;
-    }
-    double delta_x;
-    double delta_y;
-    double delta_angle;
-};
-
-struct MotionTrajectory {
-    MotionTrajectory() {}
-    MotionTrajectory(double coord_x, double coord_y, double _angle) {
-        position_x = coord_x;
-        position_y = coord_y;
-        angle = _angle;
-    }
-    double position_x;
-    double position_y;
-    double angle;
-};
+bool STREAMING = false;
+bool LIVE = false;
+int LOOKAHEAD = -1;  // -1 - по умолчанию: NFRAMES_SMOOTH_COEF, в живом LIVE_DEFAULT_LOOKAHEAD
+bool PIPELINE = false;
+bool CHUNKED = false;
+int CHUNKS = 0;  // 0 - по числу ядер
+RenderMode RENDER_MODE = RenderMode::FUSED;
+int RENDER_THREADS = 0;  // 0 - cv::getNumThreads(), 1 - отрисовка в главном потоке
+int RENDER_WINDOW = 0;   // 0 - RENDER_THREADS + RENDER_WINDOW_EXTRA_FRAMES
+std::string SMOOTHER_NAME = "box";
+int SMOOTH_RADIUS = NFRAMES_SMOOTH_COEF;
+bool SMOOTH_RADIUS_SET = false;
+bool USE_ANALYSIS_CACHE = false;
+AnalysisOptions ANALYSIS_OPTIONS;
+bool MOTION_MODEL_SET = false;
+int ANALYSIS_MAX_HEIGHT = 0;  // 0 - не ограничивать
+bool ANALYSIS_REPORT = false;
+bool COUNT_ALLOCATIONS = false;
+bool BATCH = false;
+int BATCH_JOBS = 0;          // 0 - по числу ядер
+bool SHOW_PROGRESS = true;   // в пакетном режиме строка прогресса только мешает
+std::string METRICS_PATH;    // пусто - метрики не собираются
+Metrics::Format METRICS_FORMAT = Metrics::Format::PROMETHEUS;
+bool METRICS_FORMAT_SET = false;
+double METRICS_INTERVAL = 0.0;  // 0 - только в конце
+Metrics *METRICS = nullptr;
+bool TRAJECTORY_DUMP = false;  // покадровые числа в <output>.trajectory.* вместо лога
+TrajectoryDump::Format TRAJECTORY_DUMP_FORMAT = TrajectoryDump::Format::CSV;
+std::string OUTPUT_PATH;  // пусто - <name>_stabilized.<ext>, а для stdin - stdout
+YuvFormat RAW_YUV_FORMAT;  // размер и частота сырого YUV (--yuv-size, --yuv-fps)
 
 bool isFFmpegEnabled() {
     std::string build_info = cv::getBuildInformation();
@@ -61,17 +75,276 @@ void printHelp() {
               << std::endl;
     std::cout << "  --BORDER_CROP_PIXELS=N  Set border crop pixels (default: AUTO CALCULATED)"
               << std::endl;
+    std::cout << "  --streaming           Single pass: decode every frame once, bounded memory"
+              << std::endl;
+    std::cout << "  --live                Live source (device index, URL, pipe): causal smoothing, "
+                 "adaptive crop, latency report"
+              << std::endl;
+    std::cout << "  --lookahead=N         Frames of lookahead in streaming/live mode (0 = causal)"
+              << std::endl;
+    std::cout << "  --pipeline            Run decode, grayscale and motion estimation in parallel "
+                 "threads"
+              << std::endl;
+    std::cout << "  --chunks[=N]          Analyze N time segments of the video in parallel "
+                 "(default: CPU cores)"
+              << std::endl;
+    std::cout << "  --render=MODE         fused (default, one resample per pixel) or three-step "
+                 "(warpAffine + crop + resize)"
+              << std::endl;
+    std::cout << "  --render-threads=N    Render N frames of the second pass in parallel "
+                 "(default: OpenCV threads, 1 = serial)"
+              << std::endl;
+    std::cout << "  --render-window=N     Frames in flight during parallel rendering "
+                 "(default: threads + "
+              << RENDER_WINDOW_EXTRA_FRAMES << ")" << std::endl;
+    std::cout << "  --smoother=NAME       Trajectory smoother: box (default), gaussian, kalman"
+              << std::endl;
+    std::cout << "  --smooth-radius=N     Smoothing half-window in frames (default: "
+              << NFRAMES_SMOOTH_COEF << ", gaussian sigma = N/2)" << std::endl;
+    std::cout << "  --cache               Reuse/store motion analysis in <video>.vmcache"
+              << std::endl;
+    std::cout << "  --analysis-downscale=N  Estimate motion on frames N times smaller (1..16)"
+              << std::endl;
+    std::cout << "  --analysis-height=H   Downscale analysis frames to at most H rows" << std::endl;
+    std::cout << "  --analysis-report     Also analyze at full resolution and log the trajectory "
+                 "error of the downscaled analysis"
+              << std::endl;
+    std::cout << "  --redetect-every-frame  Detect features from scratch on every frame instead "
+                 "of tracking them"
+              << std::endl;
+    std::cout << "  --global-features     Detect features over the whole frame instead of a grid "
+                 "of tiles"
+              << std::endl;
+    std::cout << "  --motion-model=NAME   translation, rigid (default) or similarity (also "
+                 "stabilizes zoom)"
+              << std::endl;
+    std::cout << "  --analysis-fps=N      Keep motion analysis at N frames/s: fewer features, "
+                 "smaller LK window, smaller frames when behind"
+              << std::endl;
+    std::cout << "  --phase-correlation   Translation only: estimate the shift by FFT phase "
+                 "correlation, without features"
+              << std::endl;
+    std::cout << "  --batch               Treat the input as a directory, a glob pattern or a "
+                 "manifest file and stabilize every video in it"
+              << std::endl;
+    std::cout << "  --jobs=N              Videos processed in parallel in batch mode "
+                 "(default: CPU cores)"
+              << std::endl;
+    std::cout << "  --metrics=FILE        Export per-stage latency histograms and counters"
+              << std::endl;
+    std::cout << "  --metrics-format=json|prometheus  Metrics file format (default: by extension, "
+                 ".json or Prometheus text)"
+              << std::endl;
+    std::cout << "  --metrics-interval=S  Also rewrite the metrics file every S seconds"
+              << std::endl;
+    std::cout << "  --trajectory-dump=csv|binary  Write per-frame shifts and trajectories to "
+                 "<output>.trajectory.csv|.bin instead of the log"
+              << std::endl;
+    std::cout << "  --output=FILE         Output path; '-' writes to stdout (Y4M/YUV input only)"
+              << std::endl;
+    std::cout << "  --yuv-size=WxH        Frame size of raw YUV420 input (.yuv or '-'); '-' "
+                 "without it is read as Y4M"
+              << std::endl;
+    std::cout << "  --yuv-fps=N[:D]       Frame rate of raw YUV420 input (default: 25)"
+              << std::endl;
+    std::cout << "  --count-allocations   Log cv::Mat allocations per frame in steady state"
+              << std::endl;
     std::cout << "  --help                Show this help message" << std::endl;
 }
 
+// exit() не вызывает деструктор логгера: то, что ещё лежит в кольце, дописываем сами
+[[noreturn]] void exitFlushingLog(Logger &logger, int code) {
+    logger.flush();
+    exit(code);
+}
+
 void processCLIArgs(int argc, char **argv, Logger &logger) {
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--help") {
             printHelp();
-            exit(0);
+            exitFlushingLog(logger, 0);
         } else if (arg == "--debug") {
             DEBUG = true;
+        } else if (arg == "--streaming") {
+            STREAMING = true;
+        } else if (arg == "--live") {
+            LIVE = true;
+        } else if (arg.rfind("--lookahead=", 0) == 0) {
+            try {
+                LOOKAHEAD = std::stoi(arg.substr(12));
+                if (LOOKAHEAD < 0) {
+                    throw std::out_of_range("lookahead");
+                }
+            } catch (const std::exception &) {
+                std::cerr << "Ошибка: Некорректное значение для --lookahead!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+        } else if (arg == "--pipeline") {
+            PIPELINE = true;
+        } else if (arg == "--render=fused") {
+            RENDER_MODE = RenderMode::FUSED;
+        } else if (arg == "--render=three-step") {
+            RENDER_MODE = RenderMode::THREE_STEP;
+        } else if (arg.rfind("--smoother=", 0) == 0) {
+            SMOOTHER_NAME = arg.substr(11);
+            if (!createTrajectorySmoother(SMOOTHER_NAME, SMOOTH_RADIUS)) {
+                std::cerr << "Ошибка: Неизвестный сглаживатель '" << SMOOTHER_NAME << "'!"
+                          << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+        } else if (arg.rfind("--smooth-radius=", 0) == 0) {
+            try {
+                SMOOTH_RADIUS = std::stoi(arg.substr(16));
+                if (SMOOTH_RADIUS < 0) {
+                    throw std::out_of_range("negative radius");
+                }
+                SMOOTH_RADIUS_SET = true;
+            } catch (const std::exception &) {
+                std::cerr << "Ошибка: Некорректное значение для --smooth-radius!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+        } else if (arg.rfind("--analysis-downscale=", 0) == 0) {
+            try {
+                ANALYSIS_OPTIONS.downscale = std::stoi(arg.substr(21));
+                if (ANALYSIS_OPTIONS.downscale < 1 ||
+                    ANALYSIS_OPTIONS.downscale > MAX_ANALYSIS_DOWNSCALE) {
+                    throw std::out_of_range("downscale");
+                }
+            } catch (const std::exception &) {
+                std::cerr << "Ошибка: Некорректное значение для --analysis-downscale!"
+                          << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+        } else if (arg.rfind("--analysis-height=", 0) == 0) {
+            try {
+                ANALYSIS_MAX_HEIGHT = std::stoi(arg.substr(18));
+                if (ANALYSIS_MAX_HEIGHT <= 0) {
+                    throw std::out_of_range("height");
+                }
+            } catch (const std::exception &) {
+                std::cerr << "Ошибка: Некорректное значение для --analysis-height!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+        } else if (arg == "--redetect-every-frame") {
+            ANALYSIS_OPTIONS.persistent_tracks = false;
+        } else if (arg == "--global-features") {
+            ANALYSIS_OPTIONS.feature_grid = false;
+        } else if (arg.rfind("--motion-model=", 0) == 0) {
+            if (!parseMotionModel(arg.substr(15), ANALYSIS_OPTIONS.motion_model)) {
+                std::cerr << "Ошибка: Некорректное значение для --motion-model!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+            MOTION_MODEL_SET = true;
+        } else if (arg.rfind("--analysis-fps=", 0) == 0) {
+            try {
+                ANALYSIS_OPTIONS.target_fps = std::stod(arg.substr(15));
+                if (ANALYSIS_OPTIONS.target_fps <= 0.0) {
+                    throw std::out_of_range("analysis fps");
+                }
+            } catch (const std::exception &) {
+                std::cerr << "Ошибка: Некорректное значение для --analysis-fps!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+        } else if (arg == "--phase-correlation") {
+            ANALYSIS_OPTIONS.phase_correlation = true;
+        } else if (arg == "--analysis-report") {
+            ANALYSIS_REPORT = true;
+        } else if (arg == "--batch") {
+            BATCH = true;
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            try {
+                BATCH_JOBS = std::stoi(arg.substr(7));
+                if (BATCH_JOBS < 0) {
+                    throw std::out_of_range("jobs");
+                }
+            } catch (const std::exception &) {
+                std::cerr << "Ошибка: Некорректное значение для --jobs!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+        } else if (arg.rfind("--metrics=", 0) == 0) {
+            METRICS_PATH = arg.substr(10);
+        } else if (arg == "--metrics-format=json") {
+            METRICS_FORMAT = Metrics::Format::JSON;
+            METRICS_FORMAT_SET = true;
+        } else if (arg == "--metrics-format=prometheus") {
+            METRICS_FORMAT = Metrics::Format::PROMETHEUS;
+            METRICS_FORMAT_SET = true;
+        } else if (arg.rfind("--metrics-interval=", 0) == 0) {
+            try {
+                METRICS_INTERVAL = std::stod(arg.substr(19));
+                if (METRICS_INTERVAL < 0.0) {
+                    throw std::out_of_range("interval");
+                }
+            } catch (const std::exception &) {
+                std::cerr << "Ошибка: Некорректное значение для --metrics-interval!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+        } else if (arg == "--trajectory-dump=csv") {
+            TRAJECTORY_DUMP = true;
+            TRAJECTORY_DUMP_FORMAT = TrajectoryDump::Format::CSV;
+        } else if (arg == "--trajectory-dump=binary") {
+            TRAJECTORY_DUMP = true;
+            TRAJECTORY_DUMP_FORMAT = TrajectoryDump::Format::BINARY;
+        } else if (arg.rfind("--output=", 0) == 0) {
+            OUTPUT_PATH = arg.substr(9);
+        } else if (arg.rfind("--yuv-size=", 0) == 0) {
+            int width = 0;
+            int height = 0;
+            if (std::sscanf(arg.c_str() + 11, "%dx%d", &width, &height) != 2 || width <= 0 ||
+                height <= 0 || width % 2 != 0 || height % 2 != 0) {
+                std::cerr << "Ошибка: Некорректное значение для --yuv-size (нужно WxH, чётные)!"
+                          << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+            RAW_YUV_FORMAT.width = width;
+            RAW_YUV_FORMAT.height = height;
+        } else if (arg.rfind("--yuv-fps=", 0) == 0) {
+            int num = 0;
+            int den = 1;
+            if (std::sscanf(arg.c_str() + 10, "%d:%d", &num, &den) < 1 || num <= 0 || den <= 0) {
+                std::cerr << "Ошибка: Некорректное значение для --yuv-fps!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+            RAW_YUV_FORMAT.frame_rate_num = num;
+            RAW_YUV_FORMAT.frame_rate_den = den;
+        } else if (arg == "--count-allocations") {
+            COUNT_ALLOCATIONS = true;
+        } else if (arg == "--cache") {
+            USE_ANALYSIS_CACHE = true;
+        } else if (arg.rfind("--render-threads=", 0) == 0) {
+            try {
+                RENDER_THREADS = std::stoi(arg.substr(17));
+                if (RENDER_THREADS < 0) {
+                    throw std::out_of_range("render threads");
+                }
+            } catch (const std::exception &) {
+                std::cerr << "Ошибка: Некорректное значение для --render-threads!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+        } else if (arg.rfind("--render-window=", 0) == 0) {
+            try {
+                RENDER_WINDOW = std::stoi(arg.substr(16));
+                if (RENDER_WINDOW < 1) {
+                    throw std::out_of_range("render window");
+                }
+            } catch (const std::exception &) {
+                std::cerr << "Ошибка: Некорректное значение для --render-window!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
+        } else if (arg == "--chunks") {
+            CHUNKED = true;
+        } else if (arg.rfind("--chunks=", 0) == 0) {
+            try {
+                CHUNKS = std::stoi(arg.substr(9));
+                if (CHUNKS < 1) {
+                    throw std::out_of_range("chunks");
+                }
+                CHUNKED = true;
+            } catch (const std::exception &) {
+                std::cerr << "Ошибка: Некорректное значение для --chunks!" << std::endl;
+                exitFlushingLog(logger, -1);
+            }
         } else if (arg == "--BORDER_CROP_PIXELS=AUTO") {
             AUTO_BORDER_CROP_PIXELS = true;
         } else if (arg.rfind("--BORDER_CROP_PIXELS=", 0) == 0) {
@@ -80,18 +353,36 @@ void processCLIArgs(int argc, char **argv, Logger &logger) {
                 if (BORDER_CROP_PIXELS < 0 || BORDER_CROP_PIXELS > MAX_CROP_PIXELS) {
                     logger.log(LogLevel::ERROR,
                                "Ошибка: Некорректное значение для BORDER_CROP_PIXELS!");
-                    exit(-1);
+                    exitFlushingLog(logger, -1);
                 }
                 AUTO_BORDER_CROP_PIXELS = false;
+                BORDER_CROP_PIXELS_SET = true;
             } catch (const std::exception &) {
                 std::cerr << "Ошибка: Некорректное значение для BORDER_CROP_PIXELS!" << std::endl;
-                exit(-1);
+                exitFlushingLog(logger, -1);
             }
         } else if (arg[0] == '-') {
             std::cerr << "Предупреждение: Неизвестный флаг '" << arg << "' будет проигнорирован."
                       << std::endl;
         }
     }
+
+    // В живом и потоковом режимах --smooth-radius - окно назад, сглаживатель там не используется
+    if (SMOOTH_RADIUS_SET && !LIVE && !STREAMING &&
+        !createTrajectorySmoother(SMOOTHER_NAME, SMOOTH_RADIUS)->usesRadius()) {
+        logger.log(LogLevel::WARNING, "Сглаживатель ", SMOOTHER_NAME,
+                   " не использует --smooth-radius, ключ игнорируется");
+    }
+
+    // Фазовая корреляция видит только сдвиг
+    if (ANALYSIS_OPTIONS.phase_correlation) {
+        if (MOTION_MODEL_SET && ANALYSIS_OPTIONS.motion_model != MotionModel::TRANSLATION) {
+            std::cerr << "Ошибка: --phase-correlation работает только с --motion-model=translation!"
+                      << std::endl;
+            exitFlushingLog(logger, -1);
+        }
+        ANALYSIS_OPTIONS.motion_model = MotionModel::TRANSLATION;
+    }
 }
 
 VideoInfo getVideoInfo(cv::VideoCapture &video_reader) {
@@ -106,239 +397,630 @@ VideoInfo getVideoInfo(cv::VideoCapture &video_reader) {
     return video_info;
 }
 
-std::vector<FrameTransformation> calculateFrameShifts(cv::VideoCapture &video_reader,
-                                                      Logger &logger, const VideoInfo &video_info) {
-    std::vector<FrameTransformation> frame_shift_info;
-    cv::Mat last_good_Transformation;
-    cv::Mat current_frame;
-    cv::Mat previous_frame;
-    video_reader >> previous_frame;
-    cv::Mat previous_grey_frame = GrayscaleConverter::convertToGray(previous_frame);
-
-    int frame_counter = 1;
+void printProgress(int frame_counter, const VideoInfo &video_info, size_t tracked_points) {
+    if (!SHOW_PROGRESS || video_info.total_frames <= 0) {
+        return;
+    }
+    std::cout << "\rОбработка кадра: " << frame_counter + 1 << " / " << video_info.total_frames
+              << " [" << std::string((frame_counter * 50) / video_info.total_frames, '=')
+              << std::string(50 - (frame_counter * 50) / video_info.total_frames, ' ') << "] "
+              << " Найденные точки: " << tracked_points << std::flush;
+}
 
-    while (true) {
-        video_reader >> current_frame;
+void finishProgress() {
+    if (SHOW_PROGRESS) {
+        std::cout << " " << std::endl;
+    }
+}
 
-        if (current_frame.empty()) {
-            std::cout << " " << std::endl;
-            logger.log(LogLevel::INFO, "Все фреймы входного видео обработаны!");
-            break;
-        }
+// VideoWriter - cv::VideoWriter или YuvWriter
+template <typename VideoWriter>
+void writeFrame(VideoWriter &video_writer, const cv::Mat &frame) {
+    ScopedStageTimer timer(METRICS, Metrics::Stage::ENCODE);
+    video_writer.write(frame);
+    if (METRICS != nullptr) {
+        METRICS->increment(Metrics::Counter::FRAMES_WRITTEN);
+    }
+}
 
-        std::vector<cv::Point2f> all_keypoints_curr;
-        std::vector<cv::Point2f> all_keypoints_prev;
-        std::vector<cv::Point2f> filtered_keypoints_curr;
-        std::vector<cv::Point2f> filtered_keypoints_prev;
-        std::vector<uchar> tracking_status;
-        std::vector<float> tracking_err;
+void rewindVideo(cv::VideoCapture &video_reader) { video_reader.set(cv::CAP_PROP_POS_FRAMES, 0); }
 
-        cv::Mat current_grey_frame = GrayscaleConverter::convertToGray(current_frame);
+void rewindVideo(YuvReader &video_reader) { video_reader.rewind(); }
 
-        goodFeaturesToTrack(previous_grey_frame, all_keypoints_prev, GOOD_FEATURES_MAX_POINTS,
-                            GOOD_FEATURES_POINT_QUALITY, GOOD_FEATURES_POINTS_MIN_DIST_PX);
-        calcOpticalFlowPyrLK(previous_grey_frame, current_grey_frame, all_keypoints_prev,
-                             all_keypoints_curr, tracking_status, tracking_err);
+// cv::VideoCapture/YuvReader и cv::VideoWriter/YuvWriter для ClipStabilizer
+template <typename VideoReader>
+class ReaderSource : public FrameSource {
+   public:
+    explicit ReaderSource(VideoReader &video_reader) : videoReader(video_reader) {}
+    bool read(cv::Mat &frame) override { return videoReader.read(frame); }
+    void rewind() override { rewindVideo(videoReader); }
 
-        for (size_t i = 0; i < tracking_status.size(); i++) {
-            if (tracking_status[i] == SUCCESS_TRACKING_STATUS) {
-                filtered_keypoints_prev.push_back(all_keypoints_prev[i]);
-                filtered_keypoints_curr.push_back(all_keypoints_curr[i]);
-            }
-        }
+   private:
+    VideoReader &videoReader;
+};
 
-        cv::Mat T = estimateAffinePartial2D(filtered_keypoints_prev, filtered_keypoints_curr);
+template <typename VideoWriter>
+class WriterSink : public FrameSink {
+   public:
+    explicit WriterSink(VideoWriter &video_writer) : videoWriter(video_writer) {}
+    void write(const cv::Mat &frame) override { writeFrame(videoWriter, frame); }
 
-        if (T.empty()) {
-            last_good_Transformation.copyTo(T);
-            logger.log(LogLevel::INFO, "Преобразование не найдено, вероятно кадр статичный????");
-        }
+   private:
+    VideoWriter &videoWriter;
+};
 
-        T.copyTo(last_good_Transformation);
+cv::Size frameSize(const VideoInfo &video_info) {
+    return {static_cast<int>(video_info.frame_width), static_cast<int>(video_info.frame_height)};
+}
 
-        double delta_x = T.at<double>(0, 2);
-        double delta_y = T.at<double>(1, 2);
-        double delta_angle = atan2(T.at<double>(1, 0), T.at<double>(0, 0));
+// Двухпроходный режим - обёртка над ClipStabilizer, как потоковый и живой над Stabilizer.
+// В CLI остаются выбор анализа (кэш, отрезки, конвейер), файлы и прогресс.
+ClipOptions clipOptionsFor(const AnalysisOptions &analysis_options, ChromaSiting siting) {
+    ClipOptions options;
+    options.analysis = analysis_options;
+    options.smoother = SMOOTHER_NAME;
+    options.smooth_radius = SMOOTH_RADIUS;
+    options.auto_crop = AUTO_BORDER_CROP_PIXELS;
+    options.border_crop_pixels = BORDER_CROP_PIXELS;
+    options.render_mode = RENDER_MODE;
+    options.chroma_siting = siting;
+    options.render_threads = RENDER_THREADS;
+    options.render_window = RENDER_WINDOW;
+    options.preview = DEBUG;
+    return options;
+}
 
-        frame_shift_info.push_back(FrameTransformation(delta_x, delta_y, delta_angle));
+ClipStabilizer::ProgressCallback progressFor(const VideoInfo &video_info) {
+    return [&video_info](int frame_counter, size_t tracked_points) {
+        printProgress(frame_counter, video_info, tracked_points);
+    };
+}
 
-        logger.log(LogLevel::TO_FILE_ONLY, "Кадр=", frame_counter, " delta_x=", delta_x,
-                   " delta_y=", delta_y, " delta_angle=", delta_angle);
+// Потоковый и живой режимы - обёртки над Stabilizer: ключи командной строки переводятся
+// в StabilizerOptions, а CLI остаётся чтение, запись, прогресс и отчёты
+StabilizerOptions stabilizerOptionsFor(const AnalysisOptions &analysis_options,
+                                       ChromaSiting siting, const VideoInfo &video_info) {
+    StabilizerOptions options;
+    options.analysis = analysis_options;
+    options.chroma_siting = siting;
+    options.border_crop_pixels = BORDER_CROP_PIXELS;
+    options.render_mode = RENDER_MODE;
+    if (LIVE) {
+        options.history = SMOOTH_RADIUS;
+        options.lookahead = LOOKAHEAD >= 0 ? LOOKAHEAD : LIVE_DEFAULT_LOOKAHEAD;
+        options.adaptive_crop = !BORDER_CROP_PIXELS_SET;
+        // Живой режим всегда в бюджете: по умолчанию - кадр источника
+        if (options.analysis.target_fps <= 0.0) {
+            options.analysis.target_fps =
+                video_info.frame_rate > 0 ? video_info.frame_rate : LIVE_DEFAULT_FPS;
+        }
+    } else {
+        // Окно потокового режима - то же скользящее среднее, что и box, того же радиуса
+        int radius = SMOOTH_RADIUS_SET ? SMOOTH_RADIUS : NFRAMES_SMOOTH_COEF;
+        options.history = radius;
+        options.lookahead = LOOKAHEAD >= 0 ? LOOKAHEAD : radius;
+    }
+    return options;
+}
 
-        current_frame.copyTo(previous_frame);
-        current_grey_frame.copyTo(previous_grey_frame);
+template <typename VideoReader, typename VideoWriter>
+int writeStabilizedVideoStreaming(VideoReader &video_reader, VideoWriter &video_writer,
+                                  const StabilizerOptions &options, Logger &logger,
+                                  const VideoInfo &video_info, TrajectoryDump *dump) {
+    Stabilizer stabilizer(frameSize(video_info), logger, options);
+    stabilizer.setMetrics(METRICS);
+    stabilizer.setTrajectoryDump(dump);
+
+    StabilizedFrame stabilized;
+    auto write_ready_frames = [&] {
+        while (stabilizer.pull(stabilized)) {
+            writeFrame(video_writer, stabilized.image);
+            if (DEBUG) {
+                showDebugPreview(stabilized.source, stabilized.image,
+                                 options.analysis.input_format);
+            }
+            stabilizer.recycle(std::move(stabilized.image));
+        }
+    };
 
-        std::cout << "\rОбработка кадра: " << frame_counter + 1 << " / " << video_info.total_frames
-                  << " [" << std::string((frame_counter * 50) / video_info.total_frames, '=')
-                  << std::string(50 - (frame_counter * 50) / video_info.total_frames, ' ') << "] "
-                  << " Найденные точки: " << filtered_keypoints_prev.size() << std::flush;
+    SteadyStateAllocationProbe allocation_probe("потоковый режим", logger);
+    cv::Mat frame;
+    int frame_counter = 0;
+    while (timeStage(METRICS, Metrics::Stage::DECODE, [&] { return video_reader.read(frame); })) {
+        try {
+            // frame меняется на освободившийся буфер - в него декодируется следующий кадр
+            stabilizer.push(frame);
+        } catch (cv::Exception &e) {
+            logger.log(LogLevel::ERROR, "OpenCV Exception: ", e.what(), " на кадре ",
+                       frame_counter);
+        }
+        write_ready_frames();
+        allocation_probe.onFrame();
+        printProgress(frame_counter, video_info, stabilizer.trackedPoints());
         frame_counter++;
     }
+    finishProgress();
+    if (stabilizer.budget() != nullptr) {
+        logBudgetReport(logger, *stabilizer.budget());
+    }
+    allocation_probe.report();
 
-    return frame_shift_info;
+    stabilizer.finish();
+    write_ready_frames();
+    logger.log(LogLevel::INFO, "Готово, стабилизированное видео сохранено! Кадров записано: ",
+               stabilizer.framesEmitted());
+    return static_cast<int>(stabilizer.framesEmitted());
 }
 
-std::vector<MotionTrajectory> buildTrajectory(
-    const std::vector<FrameTransformation> &frame_shift_info, Logger &logger) {
-    double x = 0;
-    double y = 0;
-    double a = 0;
-    std::vector<MotionTrajectory> trajectory;
+// Кадр живого источника и момент, когда он был захвачен
+struct CapturedFrame {
+    cv::Mat frame;
+    std::chrono::steady_clock::time_point captured;
+};
 
-    for (size_t i = 0; i < frame_shift_info.size(); i++) {
-        x += frame_shift_info[i].delta_x;
-        y += frame_shift_info[i].delta_y;
-        a += frame_shift_info[i].delta_angle;
-        trajectory.push_back(MotionTrajectory(x, y, a));
+void logLiveReport(Logger &logger, size_t frames, uint64_t dropped, const Histogram &latency,
+                   const Stabilizer &stabilizer) {
+    logger.log(LogLevel::INFO, "Живой режим: кадров ", frames, ", выброшено ", dropped,
+               "; задержка p50 ", latency.quantile(0.5) / 1e6, " мс, p95 ",
+               latency.quantile(0.95) / 1e6, " мс, макс ", static_cast<double>(latency.max()) / 1e6,
+               " мс; нагрузка ", stabilizer.budget()->load() * 100.0, "%, анализ уменьшен в ",
+               stabilizer.analysisDownscale(), " раз, рамка ", stabilizer.currentCropY(), "x",
+               stabilizer.currentCropX());
+}
 
-        logger.log(LogLevel::TO_FILE_ONLY, "Траектория => Кадр:", i + 1, ", x=", x, ", y=", y,
-                   ", angle=", a);
-    }
+// Живой режим. Захват идёт в своём потоке и кладёт кадры в короткую очередь; если обработка
+// не успевает, самый старый кадр вытесняется (лучше пропустить кадр, чем копить задержку).
+// До этого бюджет анализа в Stabilizer успевает огрубить анализ. Сглаживание - окно
+// [i - SMOOTH_RADIUS, i + lookahead], рамка адаптивная, если не задана явно.
+// Задержка "от стекла до стекла" - от возврата из read() до записи кадра.
+// paced - источник является файлом: читаем его в темпе fps, как если бы он шёл вживую.
+template <typename VideoReader, typename VideoWriter>
+int writeStabilizedVideoLive(VideoReader &video_reader, VideoWriter &video_writer,
+                             const VideoInfo &video_info, const StabilizerOptions &options,
+                             bool paced, TrajectoryDump *dump, Logger &logger) {
+    using Clock = std::chrono::steady_clock;
+    const double frame_rate = video_info.frame_rate > 0 ? video_info.frame_rate : LIVE_DEFAULT_FPS;
+    const auto frame_interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / frame_rate));
+
+    logger.log(LogLevel::INFO, "Живой режим: ", frame_rate, " кадр/с, заглядываем вперёд на ",
+               options.lookahead, " кадров, сглаживаем по ", options.history, " кадрам назад");
+
+    Stabilizer stabilizer(frameSize(video_info), logger, options);
+    stabilizer.setMetrics(METRICS);
+    stabilizer.setTrajectoryDump(dump);
+
+    std::vector<Clock::time_point> capture_times(stabilizer.heldFrames());
+    Histogram latency;
+    StabilizedFrame stabilized;
+    auto write_ready_frames = [&] {
+        while (stabilizer.pull(stabilized)) {
+            writeFrame(video_writer, stabilized.image);
+            auto glass_to_glass =
+                Clock::now() - capture_times[stabilized.index % capture_times.size()];
+            latency.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(glass_to_glass).count()));
+            if (METRICS != nullptr) {
+                METRICS->recordStage(Metrics::Stage::GLASS_TO_GLASS, glass_to_glass);
+            }
+            logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Кадр "), stabilized.index + 1,
+                       LogLiteral(" задержка "),
+                       std::chrono::duration<double, std::milli>(glass_to_glass).count(),
+                       LogLiteral(" мс"));
+            if (DEBUG) {
+                showDebugPreview(stabilized.source, stabilized.image,
+                                 options.analysis.input_format);
+            }
+            stabilizer.recycle(std::move(stabilized.image));
+        }
+    };
+
+    BoundedQueue<CapturedFrame> capture_queue(LIVE_QUEUE_CAPACITY);
+    FramePool frame_pool;
+    std::atomic<uint64_t> dropped{0};
+    std::thread capture_thread([&] {
+        auto next_frame_time = Clock::now();
+        while (true) {
+            cv::Mat frame = frame_pool.acquire();
+            if (!timeStage(METRICS, Metrics::Stage::DECODE,
+                           [&] { return video_reader.read(frame); })) {
+                break;
+            }
+            if (paced) {
+                next_frame_time += frame_interval;
+                std::this_thread::sleep_until(next_frame_time);
+            }
+            std::optional<CapturedFrame> evicted;
+            if (!capture_queue.pushEvictingOldest({std::move(frame), Clock::now()}, evicted)) {
+                break;
+            }
+            if (evicted) {
+                dropped++;
+                if (METRICS != nullptr) {
+                    METRICS->increment(Metrics::Counter::FRAMES_DROPPED);
+                }
+                frame_pool.release(std::move(evicted->frame));
+            }
+        }
+        capture_queue.close();
+    });
 
-    return trajectory;
+    size_t frame_counter = 0;
+    while (std::optional<CapturedFrame> captured = capture_queue.pop()) {
+        capture_times[frame_counter % capture_times.size()] = captured->captured;
+        try {
+            stabilizer.push(captured->frame);
+        } catch (cv::Exception &e) {
+            logger.log(LogLevel::ERROR, "OpenCV Exception: ", e.what(), " на кадре ",
+                       frame_counter);
+        }
+        write_ready_frames();
+        // После push здесь освободившийся буфер стабилизатора
+        frame_pool.release(std::move(captured->frame));
+        frame_counter++;
+
+        if (frame_counter % LIVE_REPORT_INTERVAL_FRAMES == 0) {
+            logLiveReport(logger, frame_counter, dropped.load(), latency, stabilizer);
+        }
+    }
+    capture_queue.close();
+    capture_thread.join();
+
+    stabilizer.finish();
+    write_ready_frames();
+    logLiveReport(logger, frame_counter, dropped.load(), latency, stabilizer);
+    logBudgetReport(logger, *stabilizer.budget());
+    logger.log(LogLevel::INFO, "Живой источник закончился, кадров записано: ",
+               stabilizer.framesEmitted());
+    return static_cast<int>(stabilizer.framesEmitted());
 }
 
-std::vector<MotionTrajectory> smoothTrajectory(const std::vector<MotionTrajectory> &trajectory,
-                                               Logger &logger) {
-    std::vector<MotionTrajectory> smoothed_trajectory;
+// Анализ дважды - в полном разрешении и в уменьшенном - и сравнение траекторий.
+// Возвращает результат уменьшенного анализа, чтобы не декодировать видео в третий раз.
+std::vector<FrameTransformation> analyzeWithScaleReport(const std::string &video_path,
+                                                        Logger &logger,
+                                                        const VideoInfo &video_info,
+                                                        const AnalysisOptions &options) {
+    auto timed_analysis = [&](const AnalysisOptions &run_options, double &seconds) {
+        cv::VideoCapture video_reader(video_path);
+        ReaderSource<cv::VideoCapture> source(video_reader);
+        ClipOptions clip_options;
+        clip_options.analysis = run_options;
+        ClipStabilizer clip(frameSize(video_info), logger, clip_options);
+        clip.setMetrics(METRICS);
+        int64 start = cv::getTickCount();
+        std::vector<FrameTransformation> result = clip.analyze(source, progressFor(video_info));
+        finishProgress();
+        seconds = static_cast<double>(cv::getTickCount() - start) / cv::getTickFrequency();
+        return result;
+    };
+
+    double full_seconds = 0.0;
+    double scaled_seconds = 0.0;
+    std::vector<FrameTransformation> full = timed_analysis(AnalysisOptions{}, full_seconds);
+    std::vector<FrameTransformation> scaled = timed_analysis(options, scaled_seconds);
+
+    double x = 0, y = 0, a = 0;  // накопленная разница траекторий
+    double sum_sq_xy = 0, sum_sq_a = 0, max_xy = 0, max_a = 0;
+    size_t frames = std::min(full.size(), scaled.size());
+    for (size_t i = 0; i < frames; i++) {
+        x += scaled[i].delta_x - full[i].delta_x;
+        y += scaled[i].delta_y - full[i].delta_y;
+        a += scaled[i].delta_angle - full[i].delta_angle;
+        double distance = std::hypot(x, y);
+        sum_sq_xy += distance * distance;
+        sum_sq_a += a * a;
+        max_xy = std::max(max_xy, distance);
+        max_a = std::max(max_a, std::abs(a));
+    }
+    double n = frames > 0 ? static_cast<double>(frames) : 1.0;
+
+    logger.log(LogLevel::INFO, "Отчёт по уменьшенному анализу (в ", options.downscale,
+               " раз): полное разрешение ", full_seconds, " с, уменьшенное ", scaled_seconds,
+               " с, ускорение x", full_seconds / std::max(scaled_seconds, 1e-9));
+    logger.log(LogLevel::INFO, "  Ошибка траектории: RMS ", std::sqrt(sum_sq_xy / n),
+               " пикс, макс ", max_xy, " пикс; угол RMS ", std::sqrt(sum_sq_a / n), " рад, макс ",
+               max_a, " рад");
+    if (full.size() != scaled.size()) {
+        logger.log(LogLevel::WARNING, "  Разное число кадров: ", full.size(), " и ",
+                   scaled.size());
+    }
 
-    for (size_t i = 0; i < trajectory.size(); i++) {
-        double sum_x = 0;
-        double sum_y = 0;
-        double sum_a = 0;
-        int frames_processed = 0;
+    return scaled;
+}
 
-        for (int j = -NFRAMES_SMOOTH_COEF; j <= NFRAMES_SMOOTH_COEF; j++) {
-            ptrdiff_t index = static_cast<ptrdiff_t>(i) + j;
-            if (index >= 0 && index < static_cast<ptrdiff_t>(trajectory.size())) {
-                sum_x += trajectory[index].position_x;
-                sum_y += trajectory[index].position_y;
-                sum_a += trajectory[index].angle;
+// Последовательный анализ - первый проход самого ClipStabilizer
+template <typename VideoReader>
+std::vector<FrameTransformation> analyzeSequentially(VideoReader &video_reader,
+                                                     ClipStabilizer &clip,
+                                                     const VideoInfo &video_info) {
+    ReaderSource<VideoReader> source(video_reader);
+    std::vector<FrameTransformation> frame_shift_info =
+        clip.analyze(source, progressFor(video_info));
+    finishProgress();
+    return frame_shift_info;
+}
 
-                frames_processed++;
-            }
-        }
+std::vector<FrameTransformation> analyzeVideo(cv::VideoCapture &video_reader,
+                                              ClipStabilizer &clip, const std::string &video_path,
+                                              Logger &logger, const VideoInfo &video_info) {
+    const AnalysisOptions &options = clip.settings().analysis;
+    if (ANALYSIS_REPORT) {
+        return analyzeWithScaleReport(video_path, logger, video_info, options);
+    }
 
-        double avg_x = sum_x / frames_processed;
-        double avg_y = sum_y / frames_processed;
-        double avg_a = sum_a / frames_processed;
+    if (options.target_fps > 0.0 && (CHUNKED || PIPELINE)) {
+        logger.log(LogLevel::WARNING, "--analysis-fps работает только в последовательном "
+                                      "анализе, для --chunks и --pipeline не учитывается");
+    }
 
-        smoothed_trajectory.push_back(MotionTrajectory(avg_x, avg_y, avg_a));
+    if (CHUNKED) {
+        ChunkedAnalyzer analyzer(video_path, CHUNKS, logger, options);
+        analyzer.setMetrics(METRICS);
+        std::vector<FrameTransformation> frame_shift_info =
+            analyzer.run(video_info, [&](int frames_done) {
+                printProgress(frames_done, video_info, 0);
+            });
+        finishProgress();
+        logger.log(LogLevel::INFO, "Все фреймы входного видео обработаны!");
+        return frame_shift_info;
+    }
 
-        logger.log(LogLevel::TO_FILE_ONLY, "Сглаженная раектория => Кадр:", i + 1,
-                   ", avg_x=", avg_x, ", avg_y=", avg_y, ", avg_angle=", avg_a);
+    if (PIPELINE) {
+        AnalysisPipeline pipeline(logger, options);
+        pipeline.setMetrics(METRICS);
+        std::vector<FrameTransformation> frame_shift_info =
+            pipeline.run(video_reader, [&](int frame_counter, size_t points) {
+                printProgress(frame_counter, video_info, points);
+            });
+        finishProgress();
+        logger.log(LogLevel::INFO, "Все фреймы входного видео обработаны!");
+        pipeline.logStageReport();
+        return frame_shift_info;
     }
 
-    return smoothed_trajectory;
+    return analyzeSequentially(video_reader, clip, video_info);
 }
 
-std::vector<FrameTransformation> calculateCorrectedShifts(
-    const std::vector<FrameTransformation> &frame_shift_info,
-    const std::vector<MotionTrajectory> &smoothed_trajectory, double &max_diff_x,
-    double &max_diff_y) {
-    std::vector<FrameTransformation> new_frame_shift_info;
-    double x = 0;
-    double y = 0;
-    double a = 0;
-    max_diff_x = 0.0;
-    max_diff_y = 0.0;
+// Конвейер, отрезки и отчёт по уменьшению построены на cv::VideoCapture; Y4M/YUV
+// анализируется последовательно, прямо по плоскости Y
+std::vector<FrameTransformation> analyzeVideo(YuvReader &video_reader, ClipStabilizer &clip,
+                                              const std::string &, Logger &logger,
+                                              const VideoInfo &video_info) {
+    if (CHUNKED || PIPELINE || ANALYSIS_REPORT) {
+        logger.log(LogLevel::WARNING, "Для Y4M/YUV --chunks, --pipeline и --analysis-report "
+                                      "не поддерживаются, анализируем последовательно");
+    }
+    return analyzeSequentially(video_reader, clip, video_info);
+}
 
-    for (size_t i = 0; i < frame_shift_info.size(); i++) {
-        x += frame_shift_info[i].delta_x;
-        y += frame_shift_info[i].delta_y;
-        a += frame_shift_info[i].delta_angle;
+AnalysisOptions analysisOptionsFor(const VideoInfo &video_info, PixelFormat format,
+                                   Logger &logger) {
+    AnalysisOptions analysis_options = ANALYSIS_OPTIONS;
+    analysis_options.input_format = format;
+    if (ANALYSIS_MAX_HEIGHT > 0) {
+        analysis_options.downscale = MotionEstimator::downscaleForHeight(
+            static_cast<int>(video_info.frame_height), ANALYSIS_MAX_HEIGHT);
+    }
+    if (analysis_options.downscale > 1) {
+        logger.log(LogLevel::INFO, "Анализ движения на кадрах, уменьшенных в ",
+                   analysis_options.downscale, " раз");
+    }
+    return analysis_options;
+}
 
-        double diff_x = smoothed_trajectory[i].position_x - x;
-        double diff_y = smoothed_trajectory[i].position_y - y;
-        double diff_a = smoothed_trajectory[i].angle - a;
+// Отрезки дают на стыках другие сдвиги, чем последовательный анализ, поэтому режим
+// (и число отрезков) - часть ключа кэша. Y4M/YUV всегда анализируется последовательно.
+std::string analysisModeSignature(const VideoInfo &video_info, const AnalysisOptions &options) {
+    if (options.input_format != PixelFormat::BGR || ANALYSIS_REPORT) {
+        return "";
+    }
+    if (CHUNKED) {
+        return ";mode:chunks:" +
+               std::to_string(ChunkedAnalyzer::segmentCount(
+                   CHUNKS, static_cast<int>(video_info.total_frames)));
+    }
+    return PIPELINE ? ";mode:pipeline" : "";
+}
 
-        max_diff_x = std::max(max_diff_x, diff_x);
-        max_diff_y = std::max(max_diff_y, diff_y);
+// Всё после открытия входа и выхода. VideoReader/VideoWriter - cv::VideoCapture/VideoWriter
+// или YuvReader/YuvWriter; streaming - один проход (вход, который нельзя перечитать).
+template <typename VideoReader, typename VideoWriter>
+int stabilizeOpenedVideo(VideoReader &video_reader, VideoWriter &video_writer,
+                         const std::string &input_filename, const std::string &output_filename,
+                         const VideoInfo &video_info, const AnalysisOptions &analysis_options,
+                         ChromaSiting siting, bool streaming, Logger &logger) {
+    std::unique_ptr<TrajectoryDump> trajectory_dump;
+    if (TRAJECTORY_DUMP) {
+        std::string dump_base = output_filename != "-"  ? output_filename
+                                : input_filename != "-" ? stabilizedOutputPath(input_filename)
+                                                        : "stdout";
+        std::string dump_path = TrajectoryDump::pathFor(dump_base, TRAJECTORY_DUMP_FORMAT);
+        trajectory_dump = std::make_unique<TrajectoryDump>(dump_path, TRAJECTORY_DUMP_FORMAT);
+        if (!trajectory_dump->isOpen()) {
+            logger.log(LogLevel::WARNING, "Не удалось открыть ", dump_path,
+                       ", покадровые числа пойдут в лог");
+            trajectory_dump.reset();
+        }
+    }
 
-        double corrected_delta_x = frame_shift_info[i].delta_x + diff_x;
-        double corrected_delta_y = frame_shift_info[i].delta_y + diff_y;
-        double corrected_delta_angle = frame_shift_info[i].delta_angle + diff_a;
+    if (LIVE) {
+        bool paced = std::filesystem::is_regular_file(input_filename);
+        return writeStabilizedVideoLive(video_reader, video_writer, video_info,
+                                        stabilizerOptionsFor(analysis_options, siting, video_info),
+                                        paced, trajectory_dump.get(), logger);
+    }
 
-        new_frame_shift_info.push_back(
-            FrameTransformation(corrected_delta_x, corrected_delta_y, corrected_delta_angle));
+    if (streaming) {
+        if (AUTO_BORDER_CROP_PIXELS) {
+            logger.log(LogLevel::WARNING,
+                       "В потоковом режиме авто-обрезка недоступна, используем BORDER_CROP_PIXELS=",
+                       BORDER_CROP_PIXELS);
+        }
+        if (SMOOTHER_NAME != "box") {
+            logger.log(LogLevel::WARNING, "В потоковом режиме сглаживание - скользящее среднее ",
+                       "(box), --smoother=", SMOOTHER_NAME, " игнорируется");
+        }
+        return writeStabilizedVideoStreaming(video_reader, video_writer,
+                                             stabilizerOptionsFor(analysis_options, siting,
+                                                                  video_info),
+                                             logger, video_info, trajectory_dump.get());
     }
 
-    return new_frame_shift_info;
-}
+    ClipStabilizer clip(frameSize(video_info), logger, clipOptionsFor(analysis_options, siting));
+    clip.setMetrics(METRICS);
+    clip.setTrajectoryDump(trajectory_dump.get());
 
-void writeStabilizedVideo(cv::VideoCapture &video_reader, cv::VideoWriter &video_writer,
-                          const std::vector<FrameTransformation> &new_frame_shift_info, int crop_x,
-                          int crop_y, Logger &logger) {
-    int frame_counter = 0;
-    video_reader.set(cv::CAP_PROP_POS_FRAMES, frame_counter);
-    cv::Mat T(2, 3, CV_64F);
-    cv::Mat current_frame;
+    std::vector<FrameTransformation> frame_shift_info;
+    std::unique_ptr<AnalysisCache> analysis_cache;
+    bool loaded_from_cache = false;
+    // В бюджете времени ступенька анализа зависит от скорости машины и её загрузки -
+    // такой результат не повторить, кэшировать его нельзя
+    if (USE_ANALYSIS_CACHE && analysis_options.target_fps > 0.0) {
+        logger.log(LogLevel::WARNING,
+                   "С --analysis-fps результат анализа зависит от времени, --cache не действует");
+    } else if (USE_ANALYSIS_CACHE) {
+        analysis_cache = std::make_unique<AnalysisCache>(
+            input_filename, MotionEstimator::parametersSignature(analysis_options) +
+                                analysisModeSignature(video_info, analysis_options));
+        loaded_from_cache = analysis_cache->load(frame_shift_info, logger);
+    }
 
-    while (frame_counter < static_cast<int>(new_frame_shift_info.size())) {
-        cv::Mat current_frame_rehab;
+    if (!loaded_from_cache) {
+        frame_shift_info = analyzeVideo(video_reader, clip, input_filename, logger, video_info);
+        if (analysis_cache) {
+            analysis_cache->save(frame_shift_info, logger);
+        }
+    }
 
-        try {
-            video_reader >> current_frame;
+    ReaderSource<VideoReader> source(video_reader);
+    WriterSink<VideoWriter> sink(video_writer);
+    return clip.render(source, sink, frame_shift_info);
+}
 
-            if (current_frame.empty()) {
-                logger.log(LogLevel::INFO, "Готово, стабилизированное видео сохранено!");
-                break;
-            }
+// Y4M/YUV: кадры I420 идут от входа до выхода без cv::VideoCapture/VideoWriter и без BGR
+int stabilizeYuvVideo(const std::string &input_filename, const std::string &output_filename,
+                      Logger &logger) {
+    bool raw_input = isRawYuvPath(input_filename) ||
+                     (input_filename == "-" && RAW_YUV_FORMAT.width > 0);
+    YuvReader video_reader(input_filename, raw_input ? RAW_YUV_FORMAT : YuvFormat{}, logger);
+    if (!video_reader.isOpened()) {
+        logger.log(LogLevel::ERROR, "Ошибка: не удалось открыть видео ", input_filename, "!");
+        return -1;
+    }
 
-            T.at<double>(0, 0) = cos(new_frame_shift_info[frame_counter].delta_angle);
-            T.at<double>(0, 1) = -sin(new_frame_shift_info[frame_counter].delta_angle);
-            T.at<double>(1, 0) = sin(new_frame_shift_info[frame_counter].delta_angle);
-            T.at<double>(1, 1) = cos(new_frame_shift_info[frame_counter].delta_angle);
+    VideoInfo video_info = video_reader.info();
+    if (SHOW_PROGRESS) {
+        video_info.print();
+    }
 
-            T.at<double>(0, 2) = new_frame_shift_info[frame_counter].delta_x;
-            T.at<double>(1, 2) = new_frame_shift_info[frame_counter].delta_y;
+    // На выход - Y4M, кроме .yuv и stdout при сыром входе
+    bool y4m_output = output_filename == "-" ? video_reader.isY4M()
+                                             : !isRawYuvPath(output_filename);
+    YuvWriter video_writer(output_filename, video_reader.format(), y4m_output, logger);
+    if (!video_writer.isOpened()) {
+        logger.log(LogLevel::ERROR, "Ошибка: не удалось открыть ", output_filename,
+                   " для записи!");
+        return -1;
+    }
 
-            warpAffine(current_frame, current_frame_rehab, T, current_frame.size());
+    bool streaming = STREAMING;
+    if (!streaming && !LIVE && !video_reader.isSeekable()) {
+        logger.log(LogLevel::INFO, "Вход из пайпа читается один раз - потоковый режим");
+        streaming = true;
+    }
 
-            if (crop_x * 2 >= current_frame_rehab.rows || crop_y * 2 >= current_frame_rehab.cols) {
-                logger.log(LogLevel::ERROR,
-                           "Ошибка: Обрезка выходит за границы кадра! Пропускаем кадр.");
-                continue;
-            }
+    return stabilizeOpenedVideo(video_reader, video_writer, input_filename, output_filename,
+                                video_info,
+                                analysisOptionsFor(video_info, PixelFormat::I420, logger),
+                                video_reader.format().chroma_siting, streaming, logger);
+}
 
-            current_frame_rehab =
-                current_frame_rehab(cv::Range(crop_x, current_frame_rehab.rows - crop_x),
-                                    cv::Range(crop_y, current_frame_rehab.cols - crop_y));
-            resize(current_frame_rehab, current_frame_rehab, current_frame.size());
+// Полный цикл для одного видео. Возвращает число записанных кадров или -1 при ошибке.
+// Все настройки, зависящие от видео, локальные - в пакетном режиме функцию зовут
+// одновременно из нескольких потоков.
+int stabilizeVideo(const std::string &input_filename, Logger &logger) {
+    std::string output_filename = !OUTPUT_PATH.empty()    ? OUTPUT_PATH
+                                  : input_filename == "-" ? "-"
+                                                          : stabilizedOutputPath(input_filename);
+    if (isYuvVideoPath(input_filename)) {
+        return stabilizeYuvVideo(input_filename, output_filename, logger);
+    }
+    // cv::VideoWriter не пишет в stdout: "-" стал бы файлом с таким именем
+    if (output_filename == "-") {
+        logger.log(LogLevel::ERROR, "Ошибка: --output=- работает только для входа Y4M/YUV "
+                                    "(.y4m, .yuv или stdin)!");
+        return -1;
+    }
 
-            video_writer.write(current_frame_rehab);
+    // Живой источник может быть номером устройства: "0" - первая камера
+    bool device_index = LIVE && !input_filename.empty() &&
+                        std::all_of(input_filename.begin(), input_filename.end(),
+                                    [](unsigned char c) { return std::isdigit(c) != 0; });
+    cv::VideoCapture video_reader;
+    if (device_index) {
+        video_reader.open(std::stoi(input_filename));
+    } else {
+        video_reader.open(input_filename);
+    }
 
-        } catch (cv::Exception &e) {
-            logger.log(LogLevel::ERROR, "OpenCV Exception: ", e.what(), " на кадре ",
-                       frame_counter);
-        } catch (std::exception &e) {
-            logger.log(LogLevel::ERROR, "Exception: ", e.what(), " на кадре ", frame_counter);
-        } catch (...) {
-            logger.log(LogLevel::ERROR, "Неизвестная ошибка на кадре ", frame_counter);
-        }
+    if (!video_reader.isOpened()) {
+        logger.log(LogLevel::ERROR, "Ошибка: не удалось открыть видео ", input_filename, "!");
+        return -1;
+    }
 
-        if (DEBUG) {
-            cv::Mat canvas = cv::Mat::zeros(current_frame.rows * 2 + ADDITION_PREVIEW_OFFSET,
-                                            current_frame.cols, current_frame.type());
-            current_frame.copyTo(canvas(cv::Range(0, current_frame.rows), cv::Range::all()));
-            current_frame_rehab.copyTo(canvas(
-                cv::Range(current_frame.rows + 10, current_frame.rows * 2 + 10), cv::Range::all()));
+    VideoInfo video_info = getVideoInfo(video_reader);
+    if (SHOW_PROGRESS) {
+        video_info.print();
+    }
+    if (video_info.frame_rate <= 0) {
+        logger.log(LogLevel::WARNING, "Источник не сообщает частоту кадров, считаем ",
+                   LIVE_DEFAULT_FPS);
+        video_info.frame_rate = LIVE_DEFAULT_FPS;
+    }
 
-            if (canvas.cols > 1920 || canvas.rows > 1080) {
-                resize(canvas, canvas, cv::Size(canvas.cols / 2, canvas.rows / 2));
-            }
+    int codec_type = cv::VideoWriter::fourcc('a', 'v', 'c', '1');
+    cv::VideoWriter video_writer(output_filename, codec_type, video_info.frame_rate,
+                                 cv::Size(video_info.frame_width, video_info.frame_height));
 
-            cv::imshow("Difference View: Original (Top) vs Stabilized (Bottom)", canvas);
-            cv::waitKey(20);
-            frame_counter++;
-        }
+    return stabilizeOpenedVideo(video_reader, video_writer, input_filename, output_filename,
+                                video_info,
+                                analysisOptionsFor(video_info, PixelFormat::BGR, logger),
+                                ChromaSiting::LEFT, STREAMING, logger);
+}
+
+// Пакетный режим: у каждого ролика свой лог <name>_stabilized.log, в общий лог - только
+// итог по ролику и сводка по пакету
+int runBatch(const std::string &source, Logger &logger) {
+    std::vector<std::string> clips = collectBatchInputs(source);
+    if (clips.empty()) {
+        logger.log(LogLevel::ERROR, "Ошибка: в '", source, "' не найдено ни одного видео!");
+        return -1;
+    }
+    if (DEBUG) {
+        logger.log(LogLevel::WARNING, "В пакетном режиме окно --debug отключено");
+        DEBUG = false;
+    }
+    SHOW_PROGRESS = false;
+    if (!OUTPUT_PATH.empty()) {
+        logger.log(LogLevel::WARNING, "В пакетном режиме --output не действует");
+        OUTPUT_PATH.clear();
     }
+
+    BatchScheduler scheduler(logger, BATCH_JOBS);
+    scheduler.run(clips, [](const std::string &clip) {
+        std::string log_path = std::filesystem::path(stabilizedOutputPath(clip))
+                                   .replace_extension(".log")
+                                   .string();
+        Logger clip_logger(log_path, false);
+        return stabilizeVideo(clip, clip_logger);
+    });
+    scheduler.logSummary();
+
+    return scheduler.failedClips() == 0 ? 0 : -1;
 }
 
 int main(int argc, char **argv) {
-    int threads = cv::getNumThreads();
-    std::cout << "OpenCV работает в " << threads << " потоках" << std::endl;
-
     Logger logger("log.txt");
 
     if (argc < 2) {
@@ -348,67 +1030,41 @@ int main(int argc, char **argv) {
 
     processCLIArgs(argc, argv, logger);
 
-    std::cout << "Открываем файл: " << argv[1] << std::endl;
-    cv::VideoCapture video_reader(argv[1]);
+    // Видео идёт в stdout - весь текст (прогресс, консольные строки лога) уводим в stderr
+    std::string input_path = argv[1];
+    if (!BATCH && (OUTPUT_PATH == "-" || (OUTPUT_PATH.empty() && input_path == "-"))) {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
 
-    if (!video_reader.isOpened()) {
-        logger.log(LogLevel::ERROR, "Ошибка: не удалось открыть видео!");
-        return -1;
+    int threads = cv::getNumThreads();
+    std::cout << "OpenCV работает в " << threads << " потоках" << std::endl;
+    if (COUNT_ALLOCATIONS) {
+        AllocationCounter::install();
     }
 
-    if (!isFFmpegEnabled()) {
+    if (!isFFmpegEnabled() && !isYuvVideoPath(input_path)) {
         std::cerr << "Ошибка: OpenCV собран без поддержки FFMPEG!" << std::endl;
         return -1;
     }
 
-    VideoInfo video_info = getVideoInfo(video_reader);
-    video_info.print();
-
-    int codec_type = cv::VideoWriter::fourcc('a', 'v', 'c', '1');
-    std::string input_filename(argv[1]);
-    std::string output_filename;
-    size_t dot_pos = input_filename.find_last_of(".");
-    if (dot_pos != std::string::npos) {
-        std::string extension = input_filename.substr(dot_pos);
-        output_filename = input_filename.substr(0, dot_pos) + "_stabilized" + extension;
-    } else {
-        output_filename = input_filename + "_stabilized.mp4";
-    }
-
-    cv::VideoWriter video_writer(output_filename, codec_type, video_info.frame_rate,
-                                 cv::Size(video_info.frame_width, video_info.frame_height));
-
-    std::vector<FrameTransformation> frame_shift_info =
-        calculateFrameShifts(video_reader, logger, video_info);
-
-    std::vector<MotionTrajectory> trajectory = buildTrajectory(frame_shift_info, logger);
-    std::vector<MotionTrajectory> smoothed_trajectory = smoothTrajectory(trajectory, logger);
-
-    double max_diff_x = 0.0;
-    double max_diff_y = 0.0;
-
-    std::vector<FrameTransformation> new_frame_shift_info =
-        calculateCorrectedShifts(frame_shift_info, smoothed_trajectory, max_diff_x, max_diff_y);
-
-    int crop_x = 0;
-    int crop_y = 0;
-    if (AUTO_BORDER_CROP_PIXELS) {
-        if (max_diff_x > max_diff_y) {
-            crop_x = static_cast<int>(max_diff_x);
-            crop_y = crop_x * video_info.frame_height / video_info.frame_width;
-        } else {
-            crop_y = static_cast<int>(max_diff_y);
-            crop_x = crop_y * video_info.frame_width / video_info.frame_height;
+    // Экспортёр объявлен после метрик и пишет итоговый файл в деструкторе, при любом выходе
+    Metrics metrics;
+    std::unique_ptr<MetricsExporter> metrics_exporter;
+    if (!METRICS_PATH.empty()) {
+        METRICS = &metrics;
+        if (!METRICS_FORMAT_SET) {
+            bool is_json = METRICS_PATH.size() >= 5 &&
+                           METRICS_PATH.compare(METRICS_PATH.size() - 5, 5, ".json") == 0;
+            METRICS_FORMAT = is_json ? Metrics::Format::JSON : Metrics::Format::PROMETHEUS;
         }
-    } else {
-        crop_y = BORDER_CROP_PIXELS;
-        crop_x = BORDER_CROP_PIXELS * video_info.frame_width / video_info.frame_height;
+        metrics_exporter = std::make_unique<MetricsExporter>(metrics, METRICS_PATH,
+                                                             METRICS_FORMAT, METRICS_INTERVAL);
     }
 
-    logger.log(LogLevel::INFO, "Обрезка кадров выполнена, обрезаем по ширине на ", crop_x,
-               " пикселей, по высоте на ", crop_y, " пикселей.");
-
-    writeStabilizedVideo(video_reader, video_writer, new_frame_shift_info, crop_x, crop_y, logger);
+    if (BATCH) {
+        return runBatch(argv[1], logger);
+    }
 
-    return 0;
-}
\ No newline at end of file
+    std::cout << "Открываем файл: " << argv[1] << std::endl;
+    return stabilizeVideo(argv[1], logger) < 0 ? -1 : 0;
+}
@@ -0,0 +1,245 @@
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+const double QUANTILES[] = {0.5, 0.95, 0.99};
+const char* const QUANTILE_NAMES[] = {"p50", "p95", "p99"};
+
+double nanosecondsToMs(double value) { return value / 1e6; }
+double nanosecondsToSeconds(double value) { return value / 1e9; }
+
+}  // namespace
+
+void Histogram::record(uint64_t value) {
+    buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    totalCount.fetch_add(1, std::memory_order_relaxed);
+    totalSum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current_max = maxValue.load(std::memory_order_relaxed);
+    while (value > current_max &&
+           !maxValue.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+    }
+}
+
+double Histogram::mean() const {
+    uint64_t n = count();
+    return n > 0 ? static_cast<double>(sum()) / static_cast<double>(n) : 0.0;
+}
+
+// Значения меньше 16 - каждое в своей корзине; дальше для старшего бита e
+// корзина определяется четырьмя битами после него
+size_t Histogram::bucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    int top_bit = 63 - __builtin_clzll(value);
+    auto sub_bucket =
+        static_cast<size_t>((value >> (top_bit - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return static_cast<size_t>(top_bit - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+double Histogram::bucketMidpoint(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return static_cast<double>(index);
+    }
+    int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+    double width = std::ldexp(1.0, shift);
+    return static_cast<double>(SUB_BUCKETS + index % SUB_BUCKETS) * width + width / 2.0;
+}
+
+double Histogram::quantile(double q) const {
+    uint64_t n = count();
+    if (n == 0) {
+        return 0.0;
+    }
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(n - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucketMidpoint(i), static_cast<double>(max()));
+        }
+    }
+    return static_cast<double>(max());
+}
+
+Metrics::Metrics() : startTime(std::chrono::steady_clock::now()) {}
+
+double Metrics::elapsedSeconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+double Metrics::framesPerSecond() const {
+    uint64_t frames = counters[static_cast<size_t>(Counter::FRAMES_WRITTEN)].load();
+    if (frames == 0) {
+        frames = counters[static_cast<size_t>(Counter::FRAMES_ANALYZED)].load();
+    }
+    double elapsed = elapsedSeconds();
+    return elapsed > 0.0 ? static_cast<double>(frames) / elapsed : 0.0;
+}
+
+const char* Metrics::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::DECODE:
+            return "decode";
+        case Stage::GRAYSCALE:
+            return "grayscale";
+        case Stage::ANALYSIS:
+            return "analysis";
+        case Stage::SMOOTHING:
+            return "smoothing";
+        case Stage::RENDER:
+            return "render";
+        case Stage::ENCODE:
+            return "encode";
+        case Stage::GLASS_TO_GLASS:
+            return "glass_to_glass";
+        case Stage::COUNT:
+            break;
+    }
+    return "unknown";
+}
+
+const char* Metrics::counterName(Counter counter) {
+    switch (counter) {
+        case Counter::FRAMES_ANALYZED:
+            return "frames_analyzed";
+        case Counter::FRAMES_WRITTEN:
+            return "frames_written";
+        case Counter::FEATURE_DETECTIONS:
+            return "feature_detections";
+        case Counter::FALLBACK_TRANSFORMS:
+            return "fallback_transforms";
+        case Counter::FRAMES_DROPPED:
+            return "frames_dropped";
+        case Counter::COUNT:
+            break;
+    }
+    return "unknown";
+}
+
+std::string Metrics::toJson() const {
+    std::ostringstream json;
+    json << std::setprecision(6) << "{\n  \"elapsed_seconds\": " << elapsedSeconds()
+         << ",\n  \"fps\": " << framesPerSecond() << ",\n  \"counters\": {";
+    for (size_t i = 0; i < counters.size(); i++) {
+        json << (i > 0 ? "," : "") << "\n    \"" << counterName(static_cast<Counter>(i))
+             << "\": " << counters[i].load(std::memory_order_relaxed);
+    }
+    json << "\n  },\n  \"stages\": {";
+    for (size_t i = 0; i < stages.size(); i++) {
+        const Histogram& histogram = stages[i];
+        json << (i > 0 ? "," : "") << "\n    \"" << stageName(static_cast<Stage>(i))
+             << "\": {\"count\": " << histogram.count()
+             << ", \"mean_ms\": " << nanosecondsToMs(histogram.mean());
+        for (size_t q = 0; q < std::size(QUANTILES); q++) {
+            json << ", \"" << QUANTILE_NAMES[q]
+                 << "_ms\": " << nanosecondsToMs(histogram.quantile(QUANTILES[q]));
+        }
+        json << ", \"max_ms\": " << nanosecondsToMs(static_cast<double>(histogram.max()))
+             << "}";
+    }
+    json << "\n  },\n  \"keypoints\": {\"count\": " << keypointHistogram.count()
+         << ", \"mean\": " << keypointHistogram.mean();
+    for (size_t q = 0; q < std::size(QUANTILES); q++) {
+        json << ", \"" << QUANTILE_NAMES[q]
+             << "\": " << keypointHistogram.quantile(QUANTILES[q]);
+    }
+    json << ", \"max\": " << keypointHistogram.max() << "}\n}\n";
+    return json.str();
+}
+
+std::string Metrics::toPrometheus() const {
+    std::ostringstream text;
+    text << std::setprecision(9);
+
+    text << "# HELP stabilizer_stage_seconds Latency of a stage, per frame (smoothing: per "
+            "trajectory).\n"
+         << "# TYPE stabilizer_stage_seconds summary\n";
+    for (size_t i = 0; i < stages.size(); i++) {
+        const Histogram& histogram = stages[i];
+        const char* stage = stageName(static_cast<Stage>(i));
+        for (double q : QUANTILES) {
+            text << "stabilizer_stage_seconds{stage=\"" << stage << "\",quantile=\"" << q
+                 << "\"} " << nanosecondsToSeconds(histogram.quantile(q)) << "\n";
+        }
+        text << "stabilizer_stage_seconds_sum{stage=\"" << stage << "\"} "
+             << nanosecondsToSeconds(static_cast<double>(histogram.sum())) << "\n"
+             << "stabilizer_stage_seconds_count{stage=\"" << stage << "\"} "
+             << histogram.count() << "\n";
+    }
+
+    text << "# HELP stabilizer_keypoints Tracked keypoints per analyzed frame.\n"
+         << "# TYPE stabilizer_keypoints summary\n";
+    for (double q : QUANTILES) {
+        text << "stabilizer_keypoints{quantile=\"" << q << "\"} "
+             << keypointHistogram.quantile(q) << "\n";
+    }
+    text << "stabilizer_keypoints_sum " << keypointHistogram.sum() << "\n"
+         << "stabilizer_keypoints_count " << keypointHistogram.count() << "\n";
+
+    for (size_t i = 0; i < counters.size(); i++) {
+        const char* name = counterName(static_cast<Counter>(i));
+        text << "# TYPE stabilizer_" << name << "_total counter\n"
+             << "stabilizer_" << name << "_total " << counters[i].load(std::memory_order_relaxed)
+             << "\n";
+    }
+
+    text << "# TYPE stabilizer_fps gauge\nstabilizer_fps " << framesPerSecond() << "\n"
+         << "# TYPE stabilizer_elapsed_seconds gauge\nstabilizer_elapsed_seconds "
+         << elapsedSeconds() << "\n";
+    return text.str();
+}
+
+std::string Metrics::format(Format format) const {
+    return format == Format::JSON ? toJson() : toPrometheus();
+}
+
+MetricsExporter::MetricsExporter(const Metrics& metrics, std::string path, Metrics::Format format,
+                                 double interval_seconds)
+    : metrics(metrics), path(std::move(path)), format(format), interval(interval_seconds) {
+    if (interval_seconds > 0.0) {
+        worker = std::thread([this] {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopRequested.wait_for(lock, interval, [this] { return stopping; })) {
+                writeNow();
+            }
+        });
+    }
+}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    stopRequested.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    writeNow();
+}
+
+bool MetricsExporter::writeNow() const {
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream output(temp_path, std::ios::out | std::ios::trunc);
+        if (!output) {
+            return false;
+        }
+        output << metrics.format(format);
+        if (!output) {
+            return false;
+        }
+    }
+    return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
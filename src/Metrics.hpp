@@ -0,0 +1,146 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Гистограмма неотрицательных целых (наносекунды, число точек) без блокировок:
+// на каждую степень двойки 16 линейных корзин, квантиль точен до 1/16 значения.
+// record() - один fetch_add и пара сравнений, зовётся из любых потоков.
+class Histogram {
+   public:
+    void record(uint64_t value);
+
+    uint64_t count() const { return totalCount.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return totalSum.load(std::memory_order_relaxed); }
+    uint64_t max() const { return maxValue.load(std::memory_order_relaxed); }
+    double mean() const;
+    double quantile(double q) const;
+
+   private:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucketIndex(uint64_t value);
+    static double bucketMidpoint(size_t index);
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+    std::atomic<uint64_t> totalCount{0};
+    std::atomic<uint64_t> totalSum{0};
+    std::atomic<uint64_t> maxValue{0};
+};
+
+// Метрики одного запуска: задержки стадий, число точек на кадр, счётчики событий.
+// Все записи потокобезопасны и не берут мьютекс; экспорт читает снимок "как есть".
+class Metrics {
+   public:
+    enum class Stage {
+        DECODE,
+        GRAYSCALE,
+        ANALYSIS,
+        SMOOTHING,
+        RENDER,
+        ENCODE,
+        GLASS_TO_GLASS,  // живой режим: от захвата кадра до его записи
+        COUNT
+    };
+    enum class Counter {
+        FRAMES_ANALYZED,
+        FRAMES_WRITTEN,
+        FEATURE_DETECTIONS,
+        FALLBACK_TRANSFORMS,  // кадр без преобразования: взято последнее удачное или единичное
+        FRAMES_DROPPED,       // живой режим: кадр вытеснен из очереди захвата, не обработан
+        COUNT
+    };
+    enum class Format { JSON, PROMETHEUS };
+
+    Metrics();
+
+    void recordStage(Stage stage, std::chrono::nanoseconds duration) {
+        stages[static_cast<size_t>(stage)].record(static_cast<uint64_t>(duration.count()));
+    }
+    void recordKeypoints(size_t keypoints) { keypointHistogram.record(keypoints); }
+    void increment(Counter counter, uint64_t amount = 1) {
+        counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    double elapsedSeconds() const;
+    // Сквозная скорость: записанные кадры, а если запись не дошла - проанализированные
+    double framesPerSecond() const;
+
+    std::string toJson() const;
+    std::string toPrometheus() const;
+    std::string format(Format format) const;
+
+    static const char* stageName(Stage stage);
+    static const char* counterName(Counter counter);
+
+   private:
+    std::chrono::steady_clock::time_point startTime;
+    std::array<Histogram, static_cast<size_t>(Stage::COUNT)> stages;
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::COUNT)> counters{};
+    Histogram keypointHistogram;
+};
+
+// Замер стадии на время жизни объекта. metrics == nullptr - метрики выключены,
+// тогда таймер не трогает даже часы.
+class ScopedStageTimer {
+   public:
+    ScopedStageTimer(Metrics* metrics, Metrics::Stage stage) : metrics(metrics), stage(stage) {
+        if (metrics != nullptr) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+    ~ScopedStageTimer() {
+        if (metrics != nullptr) {
+            metrics->recordStage(stage, std::chrono::steady_clock::now() - start);
+        }
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+   private:
+    Metrics* metrics;
+    Metrics::Stage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Выполняет fn под ScopedStageTimer и возвращает её результат
+template <typename StageFn>
+auto timeStage(Metrics* metrics, Metrics::Stage stage, StageFn&& fn) {
+    ScopedStageTimer timer(metrics, stage);
+    return fn();
+}
+
+// Пишет метрики в файл: раз в interval_seconds из фонового потока (0 - только в конце)
+// и обязательно при уничтожении. Файл заменяется через rename, так что сборщик
+// (например, textfile collector node_exporter) никогда не видит его недописанным.
+class MetricsExporter {
+   public:
+    MetricsExporter(const Metrics& metrics, std::string path, Metrics::Format format,
+                    double interval_seconds);
+    ~MetricsExporter();
+
+    bool writeNow() const;
+
+   private:
+    const Metrics& metrics;
+    std::string path;
+    Metrics::Format format;
+    std::chrono::duration<double> interval;
+
+    std::mutex mutex;
+    std::condition_variable stopRequested;
+    bool stopping = false;
+    std::thread worker;
+};
+
+#endif  // METRICS_H
@@ -0,0 +1,316 @@
+#include "MotionEstimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <utility>
+
+#include "../include/Config.hpp"
+#include "GrayscaleConverter.hpp"
+
+MotionEstimator::MotionEstimator(Logger& logger, const AnalysisOptions& options)
+    : logger(logger),
+      options(options),
+      minFeatureDistance(std::max(
+          1.0, static_cast<double>(GOOD_FEATURES_POINTS_MIN_DIST_PX) / options.downscale)) {
+    tracks.reserve(GOOD_FEATURES_MAX_POINTS);
+    newKeypoints.reserve(GOOD_FEATURES_MAX_POINTS);
+    currentKeypoints.reserve(GOOD_FEATURES_MAX_POINTS);
+    filteredPreviousKeypoints.reserve(GOOD_FEATURES_MAX_POINTS);
+    filteredCurrentKeypoints.reserve(GOOD_FEATURES_MAX_POINTS);
+    trackingStatus.reserve(GOOD_FEATURES_MAX_POINTS);
+    trackingError.reserve(GOOD_FEATURES_MAX_POINTS);
+    inlierMask.reserve(GOOD_FEATURES_MAX_POINTS);
+}
+
+void MotionEstimator::setDownscale(int downscale) {
+    if (downscale == options.downscale) {
+        return;
+    }
+    // Запасное преобразование хранится в координатах уменьшенного кадра
+    if (!lastGoodTransformation.empty()) {
+        const double ratio = static_cast<double>(options.downscale) / downscale;
+        lastGoodTransformation.at<double>(0, 2) *= ratio;
+        lastGoodTransformation.at<double>(1, 2) *= ratio;
+    }
+    // Точки - тоже: через полный кадр, P = s * p + (s - 1) / 2 (см. toFullResolution)
+    const double old_scale = options.downscale;
+    const double new_scale = downscale;
+    for (auto& point : tracks) {
+        point.x = static_cast<float>((old_scale * point.x + (old_scale - new_scale) / 2.0) /
+                                     new_scale);
+        point.y = static_cast<float>((old_scale * point.y + (old_scale - new_scale) / 2.0) /
+                                     new_scale);
+    }
+    options.downscale = downscale;
+    minFeatureDistance =
+        std::max(1.0, static_cast<double>(GOOD_FEATURES_POINTS_MIN_DIST_PX) / downscale);
+    // Пирамида перестраивается по предыдущему кадру уже нового масштаба. Буфер у него
+    // другой, поэтому продолжение трека помечается явно.
+    previousPyramidStale = true;
+    tracksRescaled = !tracks.empty();
+    previousFrameData = nullptr;
+}
+
+void MotionEstimator::setQuality(const AnalysisQuality& quality) {
+    setDownscale(quality.downscale);
+    if (quality.lk_window != lkWindow || quality.lk_max_level != lkMaxLevel) {
+        lkWindow = quality.lk_window;
+        lkMaxLevel = quality.lk_max_level;
+        previousPyramidStale = true;
+    }
+    maxFeatures = std::clamp(quality.max_features, 1, GOOD_FEATURES_MAX_POINTS);
+    if (tracks.size() > static_cast<size_t>(maxFeatures)) {
+        tracks.resize(maxFeatures);  // старшие точки - в начале, их и оставляем
+    }
+}
+
+AnalysisQuality MotionEstimator::quality() const {
+    return {maxFeatures, lkWindow, lkMaxLevel, options.downscale};
+}
+
+void MotionEstimator::prepareGreyFrame(const cv::Mat& frame, cv::Mat& grey_frame,
+                                       const AnalysisOptions& options) {
+    if (options.input_format == PixelFormat::BGR) {
+        GrayscaleConverter::convertToGrayDownscaled(frame, grey_frame, options.downscale);
+        return;
+    }
+
+    cv::Mat luma = lumaPlane(frame, options.input_format);
+    if (options.downscale == 1) {
+        grey_frame = luma;
+        return;
+    }
+    // Как у convertToGrayDownscaled: среднее по блокам factor x factor, неполные блоки
+    // по краям отбрасываются (INTER_AREA при целом коэффициенте - ровно среднее по блоку)
+    const int factor = options.downscale;
+    cv::Size size(luma.cols / factor, luma.rows / factor);
+    cv::resize(luma(cv::Rect(0, 0, size.width * factor, size.height * factor)), grey_frame, size,
+               0, 0, cv::INTER_AREA);
+}
+
+FrameTransformation MotionEstimator::estimate(const cv::Mat& previous_grey_frame,
+                                              const cv::Mat& current_grey_frame) {
+    ScopedStageTimer timer(metrics, Metrics::Stage::ANALYSIS);
+
+    cv::Mat T = options.phase_correlation ? correlatePhase(previous_grey_frame, current_grey_frame)
+                                          : trackFeatures(previous_grey_frame, current_grey_frame);
+    previousFrameData = current_grey_frame.data;
+    if (metrics != nullptr) {
+        metrics->increment(Metrics::Counter::FRAMES_ANALYZED);
+    }
+
+    if (T.empty()) {
+        logger.log(LogLevel::INFO, "Преобразование не найдено, вероятно кадр статичный????");
+        if (metrics != nullptr) {
+            metrics->increment(Metrics::Counter::FALLBACK_TRANSFORMS);
+        }
+        if (lastGoodTransformation.empty()) {
+            // Первый же кадр без преобразования - считаем, что камера стоит
+            return FrameTransformation(0.0, 0.0, 0.0);
+        }
+        lastGoodTransformation.copyTo(T);
+    }
+
+    T.copyTo(lastGoodTransformation);
+
+    return toFullResolution(T);
+}
+
+cv::Mat MotionEstimator::trackFeatures(const cv::Mat& previous_grey_frame,
+                                       const cv::Mat& current_grey_frame) {
+    const cv::Size lk_window(lkWindow, lkWindow);
+
+    // Пирамида предыдущего кадра уже есть, если он - текущий кадр прошлого вызова
+    bool continues_previous =
+        options.persistent_tracks && !previousPyramid.empty() &&
+        (previous_grey_frame.data == previousFrameData || tracksRescaled);
+    tracksRescaled = false;
+    if (!continues_previous) {
+        tracks.clear();
+    }
+    if (!continues_previous || previousPyramidStale) {
+        buildOpticalFlowPyramid(previous_grey_frame, previousPyramid, lk_window, lkMaxLevel,
+                                true, cv::BORDER_REFLECT_101, cv::BORDER_CONSTANT, false);
+        previousPyramidStale = false;
+    }
+
+    if (!options.persistent_tracks || tracks.size() < TRACKER_REDETECT_POINTS) {
+        detectFeatures(previous_grey_frame, tracks);
+    }
+
+    buildOpticalFlowPyramid(current_grey_frame, currentPyramid, lk_window, lkMaxLevel, true,
+                            cv::BORDER_REFLECT_101, cv::BORDER_CONSTANT, false);
+
+    // Рабочие векторы - члены класса: clear() сохраняет ёмкость, и после первых кадров
+    // они больше не перевыделяются
+    trackingStatus.clear();
+    filteredPreviousKeypoints.clear();
+    filteredCurrentKeypoints.clear();
+    inlierMask.clear();
+
+    if (!tracks.empty()) {
+        calcOpticalFlowPyrLK(previousPyramid, currentPyramid, tracks, currentKeypoints,
+                             trackingStatus, trackingError, lk_window, lkMaxLevel);
+    }
+
+    for (size_t i = 0; i < trackingStatus.size(); i++) {
+        if (trackingStatus[i] == SUCCESS_TRACKING_STATUS) {
+            filteredPreviousKeypoints.push_back(tracks[i]);
+            filteredCurrentKeypoints.push_back(currentKeypoints[i]);
+        }
+    }
+    trackedPointsCount = filteredPreviousKeypoints.size();
+    if (metrics != nullptr) {
+        metrics->recordKeypoints(trackedPointsCount);
+    }
+
+    cv::Mat T = withMotionModel(options.motion_model, [&](auto traits) {
+        return decltype(traits)::fit(filteredPreviousKeypoints, filteredCurrentKeypoints,
+                                     inlierMask);
+    });
+
+    // Дальше ведём только точки, согласные с движением камеры: выбросы RANSAC
+    // (движущиеся объекты, ошибки LK) на следующем кадре не нужны
+    tracks.clear();
+    for (size_t i = 0; i < filteredCurrentKeypoints.size(); i++) {
+        if (inlierMask.empty() || inlierMask[i] != 0) {
+            tracks.push_back(filteredCurrentKeypoints[i]);
+        }
+    }
+    std::swap(previousPyramid, currentPyramid);
+
+    return T;
+}
+
+// Предыдущий кадр в CV_32F остаётся с прошлого вызова, если это тот же буфер,
+// так что на кадр приходится одно уменьшение и одно преобразование типа
+cv::Mat MotionEstimator::correlatePhase(const cv::Mat& previous_grey_frame,
+                                        const cv::Mat& current_grey_frame) {
+    const int factor = std::max(
+        1, (previous_grey_frame.cols + PHASE_CORRELATION_MAX_WIDTH - 1) /
+               PHASE_CORRELATION_MAX_WIDTH);
+
+    cv::swap(phasePrevious, phaseCurrent);
+    const bool continues_previous = previous_grey_frame.data == previousFrameData &&
+                                    phasePrevious.cols == previous_grey_frame.cols / factor;
+    if (!continues_previous) {
+        preparePhaseFrame(previous_grey_frame, phasePrevious, factor);
+    }
+    preparePhaseFrame(current_grey_frame, phaseCurrent, factor);
+    trackedPointsCount = 0;
+
+    if (hanningWindow.size() != phaseCurrent.size()) {
+        cv::createHanningWindow(hanningWindow, phaseCurrent.size(), CV_32F);
+    }
+    double response = 0.0;
+    cv::Point2d shift = cv::phaseCorrelate(phasePrevious, phaseCurrent, hanningWindow, &response);
+    if (response < PHASE_CORRELATION_MIN_RESPONSE) {
+        return cv::Mat();
+    }
+    return cv::Mat(cv::Matx23d(1.0, 0.0, shift.x * factor, 0.0, 1.0, shift.y * factor), true);
+}
+
+void MotionEstimator::preparePhaseFrame(const cv::Mat& grey_frame, cv::Mat& phase_frame,
+                                        int factor) {
+    if (factor == 1) {
+        grey_frame.convertTo(phase_frame, CV_32F);
+        return;
+    }
+    cv::Size size(grey_frame.cols / factor, grey_frame.rows / factor);
+    cv::resize(grey_frame(cv::Rect(0, 0, size.width * factor, size.height * factor)),
+               phaseScratch, size, 0, 0, cv::INTER_AREA);
+    phaseScratch.convertTo(phase_frame, CV_32F);
+}
+
+// Новые точки ищем только вдали от уже отслеживаемых, чтобы не дублировать их
+void MotionEstimator::detectFeatures(const cv::Mat& grey_frame,
+                                     std::vector<cv::Point2f>& keypoints) {
+    detections++;
+    if (metrics != nullptr) {
+        metrics->increment(Metrics::Counter::FEATURE_DETECTIONS);
+    }
+    if (!options.persistent_tracks) {
+        keypoints.clear();
+    }
+
+    int wanted = maxFeatures - static_cast<int>(keypoints.size());
+    if (wanted <= 0) {
+        return;
+    }
+
+    const bool masked = !keypoints.empty();
+    if (masked) {
+        detectionMask.create(grey_frame.size(), CV_8UC1);
+        detectionMask.setTo(cv::Scalar(255));
+        for (const auto& point : keypoints) {
+            cv::circle(detectionMask, point, static_cast<int>(minFeatureDistance), cv::Scalar(0),
+                       cv::FILLED);
+        }
+    }
+    const cv::Mat mask = masked ? detectionMask : cv::Mat();
+
+    if (options.feature_grid) {
+        gridDetector.detect(grey_frame, maxFeatures, GOOD_FEATURES_POINT_QUALITY,
+                            minFeatureDistance, mask, keypoints);
+        return;
+    }
+
+    newKeypoints.clear();
+    goodFeaturesToTrack(grey_frame, newKeypoints, wanted, GOOD_FEATURES_POINT_QUALITY,
+                        minFeatureDistance, mask);
+    keypoints.insert(keypoints.end(), newKeypoints.begin(), newKeypoints.end());
+}
+
+// Пиксель уменьшенного кадра p покрывает блок с центром P = s * p + c, c = (s - 1) / 2.
+// Из p' = R p + t получаем P' = R P + s * t + (I - R) c: угол тот же, сдвиг растягивается.
+FrameTransformation MotionEstimator::toFullResolution(const cv::Mat& T) const {
+    const double scale = options.downscale;
+    const double center = (scale - 1.0) / 2.0;
+
+    double delta_x = T.at<double>(0, 2) * scale +
+                     (1.0 - T.at<double>(0, 0)) * center - T.at<double>(0, 1) * center;
+    double delta_y = T.at<double>(1, 2) * scale - T.at<double>(1, 0) * center +
+                     (1.0 - T.at<double>(1, 1)) * center;
+    double delta_angle = atan2(T.at<double>(1, 0), T.at<double>(0, 0));
+    double delta_scale = withMotionModel(options.motion_model, [&](auto traits) {
+        return decltype(traits)::HAS_SCALE ? log(hypot(T.at<double>(0, 0), T.at<double>(1, 0)))
+                                           : 0.0;
+    });
+
+    return FrameTransformation(delta_x, delta_y, delta_angle, delta_scale);
+}
+
+std::string MotionEstimator::parametersSignature(const AnalysisOptions& options) {
+    std::ostringstream signature;
+    signature << "gftt:" << GOOD_FEATURES_MAX_POINTS << "," << GOOD_FEATURES_POINT_QUALITY << ","
+              << GOOD_FEATURES_POINTS_MIN_DIST_PX << ";lk:" << LK_WINDOW_SIZE << ","
+              << LK_MAX_LEVEL << "," << SUCCESS_TRACKING_STATUS
+              << ";model:" << motionModelName(options.motion_model)
+              << ";downscale:" << options.downscale << ";tracks:"
+              << (options.persistent_tracks ? TRACKER_REDETECT_POINTS : 0);
+    if (options.phase_correlation) {
+        signature << ";phase:" << PHASE_CORRELATION_MAX_WIDTH << ","
+                  << PHASE_CORRELATION_MIN_RESPONSE;
+    } else if (options.feature_grid) {
+        signature << ";grid:" << FEATURE_GRID_COLS << "x" << FEATURE_GRID_ROWS << ","
+                  << FEATURE_GRID_MIN_TILE_PX << "," << FEATURE_GRID_TILE_OVERSHOOT;
+    }
+    if (options.target_fps > 0.0) {
+        signature << ";budget:" << options.target_fps << "fps";
+    }
+    if (options.input_format == PixelFormat::I420) {
+        signature << ";input:i420-luma";
+    } else if (options.input_format == PixelFormat::NV12) {
+        signature << ";input:nv12-luma";
+    }
+    signature << ";opencv:" << CV_VERSION;
+    return signature.str();
+}
+
+int MotionEstimator::downscaleForHeight(int frame_height, int max_height) {
+    if (max_height <= 0 || frame_height <= max_height) {
+        return 1;
+    }
+    return std::min(MAX_ANALYSIS_DOWNSCALE, (frame_height + max_height - 1) / max_height);
+}
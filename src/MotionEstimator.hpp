@@ -0,0 +1,134 @@
+#ifndef MOTION_ESTIMATOR_H
+#define MOTION_ESTIMATOR_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "../include/Config.hpp"
+#include "GridFeatureDetector.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "MotionModel.hpp"
+#include "MotionTypes.hpp"
+#include "YuvFrame.hpp"
+
+// Настройки анализа движения, общие для всех режимов (последовательный, конвейер, отрезки,
+// потоковый). Всё, что сюда добавляется, должно попадать в parametersSignature().
+struct AnalysisOptions {
+    int downscale = 1;              // анализ на сером кадре, уменьшенном в downscale раз
+    bool persistent_tracks = true;  // вести точки от кадра к кадру, а не искать их заново
+    bool feature_grid = true;       // искать точки по сетке тайлов (GridFeatureDetector)
+    PixelFormat input_format = PixelFormat::BGR;  // I420, NV12 - анализ прямо по плоскости Y
+    MotionModel motion_model = MotionModel::RIGID;
+    bool phase_correlation = false;  // сдвиг фазовой корреляцией, без точек (только translation)
+    double target_fps = 0.0;  // > 0 - анализ в бюджете времени (AnalysisBudgetController)
+};
+
+// То, что можно менять на ходу, чтобы уложиться в бюджет времени: число точек, окно и
+// глубина пирамиды Лукаса-Канаде, уменьшение кадра для анализа
+struct AnalysisQuality {
+    int max_features = GOOD_FEATURES_MAX_POINTS;
+    int lk_window = LK_WINDOW_SIZE;
+    int lk_max_level = LK_MAX_LEVEL;
+    int downscale = 1;
+};
+
+// Оценка сдвига/поворота между двумя соседними серыми кадрами.
+// Хранит последнее удачное преобразование, чтобы подставить его для "пустых" кадров.
+//
+// С persistent_tracks точки, пережившие LK и RANSAC, становятся входом для следующей пары,
+// а пирамида текущего кадра - пирамидой предыдущего. goodFeaturesToTrack зовётся, только
+// когда точек осталось меньше TRACKER_REDETECT_POINTS, и только там, где точек нет.
+// Для этого previous_grey_frame должен быть тем же буфером, что current_grey_frame
+// прошлого вызова (обмен кадров через cv::swap/std::move) - иначе всё строится заново.
+//
+// С phase_correlation точки не ищутся вовсе: сдвиг даёт cv::phaseCorrelate по кадрам,
+// уменьшенным до PHASE_CORRELATION_MAX_WIDTH. Это в разы дешевле поиска точек и LK, но
+// видит только сдвиг.
+class MotionEstimator {
+   public:
+    explicit MotionEstimator(Logger& logger, const AnalysisOptions& options = {});
+
+    // Цветной кадр -> серый кадр для анализа (с уменьшением, если оно включено).
+    // Для I420 и NV12 серый кадр - плоскость Y; без уменьшения это вид на сам кадр,
+    // без копирования.
+    static void prepareGreyFrame(const cv::Mat& frame, cv::Mat& grey_frame,
+                                 const AnalysisOptions& options);
+
+    // Сдвиг возвращается в пикселях исходного, не уменьшенного кадра
+    FrameTransformation estimate(const cv::Mat& previous_grey_frame,
+                                 const cv::Mat& current_grey_frame);
+
+    // Все параметры, от которых зависит результат estimate(), одной строкой (ключ кэша анализа)
+    static std::string parametersSignature(const AnalysisOptions& options);
+
+    // Во сколько раз уменьшать кадр высотой frame_height, чтобы уложиться в max_height
+    static int downscaleForHeight(int frame_height, int max_height);
+
+    // Смена уменьшения на ходу (живой режим). Отслеживаемые точки и запасное преобразование
+    // пересчитываются в новый масштаб, пирамида предыдущего кадра перестраивается; оба
+    // следующих кадра должны быть уже в новом масштабе, предыдущий - тот же кадр, что раньше.
+    void setDownscale(int downscale);
+
+    // Смена всех параметров AnalysisQuality на ходу. Уменьшение - как в setDownscale();
+    // при смене окна или глубины LK пирамида предыдущего кадра перестраивается,
+    // а отслеживаемые точки сохраняются. max_features - не больше GOOD_FEATURES_MAX_POINTS.
+    void setQuality(const AnalysisQuality& quality);
+    AnalysisQuality quality() const;
+
+    // Сколько точек удалось отследить на последнем вызове estimate()
+    size_t trackedPoints() const { return trackedPointsCount; }
+
+    // Сколько раз за всё время пришлось искать точки заново
+    size_t detectionCount() const { return detections; }
+
+    // Время estimate(), число точек и подстановки последнего удачного преобразования
+    // пишутся в metrics; nullptr - не писать
+    void setMetrics(Metrics* metrics) { this->metrics = metrics; }
+
+   private:
+    cv::Mat trackFeatures(const cv::Mat& previous_grey_frame, const cv::Mat& current_grey_frame);
+    cv::Mat correlatePhase(const cv::Mat& previous_grey_frame, const cv::Mat& current_grey_frame);
+    void preparePhaseFrame(const cv::Mat& grey_frame, cv::Mat& phase_frame, int factor);
+    void detectFeatures(const cv::Mat& grey_frame, std::vector<cv::Point2f>& keypoints);
+    FrameTransformation toFullResolution(const cv::Mat& T) const;
+
+    Logger& logger;
+    AnalysisOptions options;
+    double minFeatureDistance;
+    cv::Mat lastGoodTransformation;
+    size_t trackedPointsCount = 0;
+    size_t detections = 0;
+    Metrics* metrics = nullptr;
+    int maxFeatures = GOOD_FEATURES_MAX_POINTS;
+    int lkWindow = LK_WINDOW_SIZE;
+    int lkMaxLevel = LK_MAX_LEVEL;
+
+    // Состояние трекера между вызовами
+    std::vector<cv::Point2f> tracks;
+    std::vector<cv::Mat> previousPyramid;
+    std::vector<cv::Mat> currentPyramid;
+    const uchar* previousFrameData = nullptr;  // буфер, по которому построена previousPyramid
+    bool previousPyramidStale = false;         // с прежними окном/глубиной LK или масштабом
+    bool tracksRescaled = false;               // tracks переведены в новый масштаб
+    cv::Mat detectionMask;
+    GridFeatureDetector gridDetector;
+
+    // Рабочие буферы estimate(), переиспользуемые от кадра к кадру
+    std::vector<cv::Point2f> newKeypoints;
+    std::vector<cv::Point2f> currentKeypoints;
+    std::vector<cv::Point2f> filteredPreviousKeypoints;
+    std::vector<cv::Point2f> filteredCurrentKeypoints;
+    std::vector<uchar> trackingStatus;
+    std::vector<float> trackingError;
+    std::vector<uchar> inlierMask;
+
+    // Фазовая корреляция: кадры в CV_32F (предыдущий - с прошлого вызова) и окно Ханна
+    cv::Mat phasePrevious;
+    cv::Mat phaseCurrent;
+    cv::Mat phaseScratch;
+    cv::Mat hanningWindow;
+};
+
+#endif  // MOTION_ESTIMATOR_H
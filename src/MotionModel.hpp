@@ -0,0 +1,124 @@
+#ifndef MOTION_MODEL_H
+#define MOTION_MODEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "../include/Config.hpp"
+
+// Модель движения камеры между соседними кадрами - сколько степеней свободы оценивается.
+// translation - только сдвиг (штатив, дрон с подвесом), rigid - сдвиг и поворот,
+// similarity - ещё и масштаб (зум, движение вдоль оси камеры).
+enum class MotionModel { TRANSLATION, RIGID, SIMILARITY };
+
+// Оценщик и разбор матрицы для каждой модели выбираются при компиляции; рантайм-значение
+// MotionModel превращается в тип один раз, в withMotionModel.
+// fit(): точки предыдущего кадра -> точки текущего, ответ - матрица 2x3 CV_64F
+// (пустая, если оценить не удалось), inliers - маска согласных с ней точек.
+template <MotionModel Model>
+struct MotionModelTraits;
+
+// Сдвиг - медиана смещений точек; точки дальше MOTION_INLIER_THRESHOLD_PX от медианы -
+// выбросы, по остальным берётся среднее. Без RANSAC: для двух параметров медиана и так
+// устойчива, а стоит одного прохода.
+template <>
+struct MotionModelTraits<MotionModel::TRANSLATION> {
+    static constexpr const char* NAME = "translation";
+    static constexpr bool HAS_SCALE = false;
+
+    static cv::Mat fit(const std::vector<cv::Point2f>& from, const std::vector<cv::Point2f>& to,
+                       std::vector<uchar>& inliers) {
+        if (from.empty()) {
+            return cv::Mat();
+        }
+        std::vector<float> shifts_x(from.size());
+        std::vector<float> shifts_y(from.size());
+        for (size_t i = 0; i < from.size(); ++i) {
+            shifts_x[i] = to[i].x - from[i].x;
+            shifts_y[i] = to[i].y - from[i].y;
+        }
+        const size_t middle = from.size() / 2;
+        std::nth_element(shifts_x.begin(), shifts_x.begin() + middle, shifts_x.end());
+        std::nth_element(shifts_y.begin(), shifts_y.begin() + middle, shifts_y.end());
+        const double median_x = shifts_x[middle];
+        const double median_y = shifts_y[middle];
+
+        inliers.assign(from.size(), 0);
+        double sum_x = 0.0;
+        double sum_y = 0.0;
+        size_t count = 0;
+        for (size_t i = 0; i < from.size(); ++i) {
+            const double shift_x = to[i].x - from[i].x;
+            const double shift_y = to[i].y - from[i].y;
+            if (std::hypot(shift_x - median_x, shift_y - median_y) <= MOTION_INLIER_THRESHOLD_PX) {
+                inliers[i] = 1;
+                sum_x += shift_x;
+                sum_y += shift_y;
+                count++;
+            }
+        }
+        if (count == 0) {
+            return cv::Mat();
+        }
+        return cv::Mat(cv::Matx23d(1.0, 0.0, sum_x / count, 0.0, 1.0, sum_y / count), true);
+    }
+};
+
+// Сдвиг и поворот. Оценивается подобие (4 степени свободы, RANSAC), масштаб потом
+// отбрасывается - так анализ работал всегда.
+template <>
+struct MotionModelTraits<MotionModel::RIGID> {
+    static constexpr const char* NAME = "rigid";
+    static constexpr bool HAS_SCALE = false;
+
+    static cv::Mat fit(const std::vector<cv::Point2f>& from, const std::vector<cv::Point2f>& to,
+                       std::vector<uchar>& inliers) {
+        return from.empty() ? cv::Mat() : estimateAffinePartial2D(from, to, inliers);
+    }
+};
+
+// Подобие целиком: масштаб идёт в траекторию и сглаживается вместе со сдвигом и углом
+template <>
+struct MotionModelTraits<MotionModel::SIMILARITY> {
+    static constexpr const char* NAME = "similarity";
+    static constexpr bool HAS_SCALE = true;
+
+    static cv::Mat fit(const std::vector<cv::Point2f>& from, const std::vector<cv::Point2f>& to,
+                       std::vector<uchar>& inliers) {
+        return MotionModelTraits<MotionModel::RIGID>::fit(from, to, inliers);
+    }
+};
+
+// function(MotionModelTraits<model>{})
+template <typename Function>
+decltype(auto) withMotionModel(MotionModel model, Function&& function) {
+    switch (model) {
+        case MotionModel::TRANSLATION:
+            return function(MotionModelTraits<MotionModel::TRANSLATION>{});
+        case MotionModel::SIMILARITY:
+            return function(MotionModelTraits<MotionModel::SIMILARITY>{});
+        case MotionModel::RIGID:
+            break;
+    }
+    return function(MotionModelTraits<MotionModel::RIGID>{});
+}
+
+inline const char* motionModelName(MotionModel model) {
+    return withMotionModel(model, [](auto traits) { return decltype(traits)::NAME; });
+}
+
+inline bool parseMotionModel(const std::string& name, MotionModel& model) {
+    for (MotionModel candidate :
+         {MotionModel::TRANSLATION, MotionModel::RIGID, MotionModel::SIMILARITY}) {
+        if (name == motionModelName(candidate)) {
+            model = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif  // MOTION_MODEL_H
@@ -0,0 +1,90 @@
+#ifndef MOTION_TYPES_H
+#define MOTION_TYPES_H
+
+#include <iostream>
+#include <vector>
+
+struct VideoInfo {
+    double frame_width;
+    double frame_height;
+    double frame_rate;
+    double total_frames;
+    double duration;
+
+    void print() const {
+        std::cout << "Информация о видео:" << std::endl;
+        std::cout << "  Разрешение: " << frame_width << "x" << frame_height << std::endl;
+        std::cout << "  Частота кадров: " << frame_rate << " FPS" << std::endl;
+        std::cout << "  Количество кадров: " << total_frames << std::endl;
+        std::cout << "  Длительность: " << duration << " секунд" << std::endl;
+    }
+};
+
+// Масштаб - натуральный логарифм (0 - без изменения), чтобы складываться и сглаживаться
+// так же, как сдвиг и угол. Вне модели similarity он всегда 0.
+struct FrameTransformation {
+    FrameTransformation() {}
+    FrameTransformation(double shift_x, double shift_y, double rotation_angle,
+                        double log_scale = 0.0) {
+        delta_x = shift_x;
+        delta_y = shift_y;
+        delta_angle = rotation_angle;
+        delta_scale = log_scale;
+    }
+    double delta_x;
+    double delta_y;
+    double delta_angle;
+    double delta_scale;
+};
+
+struct MotionTrajectory {
+    MotionTrajectory() {}
+    MotionTrajectory(double coord_x, double coord_y, double _angle, double _scale = 0.0) {
+        position_x = coord_x;
+        position_y = coord_y;
+        angle = _angle;
+        scale = _scale;
+    }
+    double position_x;
+    double position_y;
+    double angle;
+    double scale;
+};
+
+// Та же траектория, разложенная по отдельным массивам: внутренние циклы сглаживания идут
+// по непрерывной памяти и векторизуются
+struct MotionTrajectorySoA {
+    MotionTrajectorySoA() {}
+    explicit MotionTrajectorySoA(const std::vector<MotionTrajectory> &trajectory) {
+        position_x.reserve(trajectory.size());
+        position_y.reserve(trajectory.size());
+        angle.reserve(trajectory.size());
+        scale.reserve(trajectory.size());
+        for (const auto &point : trajectory) {
+            position_x.push_back(point.position_x);
+            position_y.push_back(point.position_y);
+            angle.push_back(point.angle);
+            scale.push_back(point.scale);
+        }
+    }
+
+    void resize(size_t count) {
+        position_x.resize(count);
+        position_y.resize(count);
+        angle.resize(count);
+        scale.resize(count);
+    }
+
+    size_t size() const { return position_x.size(); }
+
+    MotionTrajectory at(size_t i) const {
+        return MotionTrajectory(position_x[i], position_y[i], angle[i], scale[i]);
+    }
+
+    std::vector<double> position_x;
+    std::vector<double> position_y;
+    std::vector<double> angle;
+    std::vector<double> scale;
+};
+
+#endif  // MOTION_TYPES_H
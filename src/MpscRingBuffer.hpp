@@ -0,0 +1,86 @@
+#ifndef MPSC_RING_BUFFER_H
+#define MPSC_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Ограниченное кольцо без блокировок: много писателей, один читатель (схема Вьюкова).
+// У каждой ячейки свой счётчик поколения: писатель захватывает позицию CAS-ом по enqueuePos
+// и публикует ячейку записью sequence, читатель забирает только опубликованные ячейки.
+// tryPush/tryPop никогда не ждут - что делать с полным/пустым кольцом, решает вызывающий.
+template <typename T>
+class MpscRingBuffer {
+   public:
+    // capacity округляется вверх до степени двойки
+    explicit MpscRingBuffer(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        cells = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // position - номер записи по порядку (с нуля): читатель забирает записи строго в этом
+    // порядке, так что запись прочитана, когда прочитано position + 1 записей
+    bool tryPush(const T& item, size_t& position) {
+        position = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[position & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::ptrdiff_t>(sequence) -
+                              static_cast<std::ptrdiff_t>(position);
+            if (difference == 0) {
+                if (enqueuePos.compare_exchange_weak(position, position + 1,
+                                                     std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;  // кольцо полно
+            } else {
+                position = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->item = item;
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPush(const T& item) {
+        size_t position = 0;
+        return tryPush(item, position);
+    }
+
+    // Сколько позиций уже занято писателями (часть записей может быть ещё не дописана)
+    size_t claimed() const { return enqueuePos.load(std::memory_order_acquire); }
+
+    // Только из одного потока-читателя
+    bool tryPop(T& item) {
+        Cell& cell = cells[dequeuePos & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+            return false;  // пусто или писатель ещё не дописал ячейку
+        }
+        item = cell.item;
+        cell.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+        dequeuePos++;
+        return true;
+    }
+
+   private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        T item;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) size_t dequeuePos = 0;
+};
+
+#endif  // MPSC_RING_BUFFER_H
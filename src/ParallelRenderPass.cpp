@@ -0,0 +1,120 @@
+#include "ParallelRenderPass.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+ParallelRenderPass::ParallelRenderPass(int workers, size_t window, RenderJob render,
+                                       WriteJob write, Logger& logger)
+    : render(std::move(render)),
+      write(std::move(write)),
+      logger(logger),
+      slots(std::max<size_t>(window, 1)) {
+    const int worker_count = std::max(workers, 1);
+    for (int i = 0; i < worker_count; ++i) {
+        this->workers.emplace_back([this] { workerLoop(); });
+    }
+    writer = std::thread([this] { writerLoop(); });
+}
+
+ParallelRenderPass::~ParallelRenderPass() { finish(); }
+
+void ParallelRenderPass::submit(cv::Mat& frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    const size_t slot_index = submitted % slots.size();
+    Slot& slot = slots[slot_index];
+    if (slot.state != SlotState::FREE) {
+        auto wait_start = std::chrono::steady_clock::now();
+        slotFreed.wait(lock, [&] { return slot.state == SlotState::FREE; });
+        waitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                     wait_start).count();
+    }
+
+    cv::swap(slot.source, frame);
+    slot.index = submitted;
+    slot.state = SlotState::QUEUED;
+    pendingSlots.push_back(slot_index);
+    submitted++;
+    workAvailable.notify_one();
+}
+
+void ParallelRenderPass::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finishing = true;
+    }
+    workAvailable.notify_all();
+    frameRendered.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+double ParallelRenderPass::submitWaitSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return waitSeconds;
+}
+
+// Ячейка в состоянии QUEUED принадлежит только взявшему её потоку: декодер ждёт FREE,
+// запись - RENDERED, поэтому кадры рисуются без мьютекса
+void ParallelRenderPass::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        workAvailable.wait(lock, [this] { return !pendingSlots.empty() || finishing; });
+        if (pendingSlots.empty()) {
+            return;
+        }
+        Slot& slot = slots[pendingSlots.front()];
+        pendingSlots.pop_front();
+        lock.unlock();
+
+        bool rendered_ok = false;
+        try {
+            rendered_ok = render(slot.source, slot.index, slot.rendered);
+        } catch (cv::Exception& e) {
+            logger.log(LogLevel::ERROR, "OpenCV Exception: ", e.what(), " на кадре ", slot.index);
+        } catch (std::exception& e) {
+            logger.log(LogLevel::ERROR, "Exception: ", e.what(), " на кадре ", slot.index);
+        } catch (...) {
+            logger.log(LogLevel::ERROR, "Неизвестная ошибка на кадре ", slot.index);
+        }
+
+        lock.lock();
+        slot.rendered_ok = rendered_ok;
+        slot.state = SlotState::RENDERED;
+        frameRendered.notify_all();
+    }
+}
+
+void ParallelRenderPass::writerLoop() {
+    static const cv::Mat missing_frame;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        Slot& slot = slots[written % slots.size()];
+        frameRendered.wait(lock, [&] {
+            return (written < submitted && slot.state == SlotState::RENDERED) ||
+                   (finishing && written >= submitted);
+        });
+        if (written >= submitted) {
+            return;
+        }
+        lock.unlock();
+
+        try {
+            write(slot.source, slot.rendered_ok ? slot.rendered : missing_frame, slot.index);
+        } catch (std::exception& e) {
+            logger.log(LogLevel::ERROR, "Ошибка записи кадра ", slot.index, ": ", e.what());
+        }
+
+        lock.lock();
+        slot.state = SlotState::FREE;
+        written++;
+        slotFreed.notify_one();
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef PARALLEL_RENDER_PASS_H
+#define PARALLEL_RENDER_PASS_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <thread>
+#include <vector>
+
+#include "Logger.hpp"
+
+// Отрисовка второго прохода по кадрам параллельно. Когда все поправки уже посчитаны,
+// кадры друг от друга не зависят: декодер отдаёт их по порядку в submit(), пул потоков
+// рисует их вразнобой, а отдельный поток записи через буфер переупорядочивания отдаёт
+// результаты строго по номерам. Кадр i живёт в ячейке i % window, так что в полёте
+// не больше window кадров (исходный и нарисованный буфер на каждый), и в установившемся
+// режиме буферы не перевыделяются.
+class ParallelRenderPass {
+   public:
+    // source -> rendered для кадра index; false или исключение - кадр пропускается
+    using RenderJob = std::function<bool(const cv::Mat& source, size_t index, cv::Mat& rendered)>;
+    // Зовётся строго по возрастанию index из одного потока; rendered пуст, если кадр
+    // нарисовать не удалось
+    using WriteJob =
+        std::function<void(const cv::Mat& source, const cv::Mat& rendered, size_t index)>;
+
+    ParallelRenderPass(int workers, size_t window, RenderJob render, WriteJob write,
+                       Logger& logger);
+    ~ParallelRenderPass();
+
+    ParallelRenderPass(const ParallelRenderPass&) = delete;
+    ParallelRenderPass& operator=(const ParallelRenderPass&) = delete;
+
+    // Кадр со следующим номером. Буфер frame забирается без копирования, взамен в frame
+    // отдаётся буфер кадра, записанного window кадров назад. Ждёт, пока ячейка не освободится.
+    void submit(cv::Mat& frame);
+
+    // Дорисовать и записать всё отправленное, остановить потоки
+    void finish();
+
+    // Сколько декодер простоял на полном окне: большое значение - узкое место в отрисовке
+    // или записи, а не в декодировании
+    double submitWaitSeconds() const;
+
+   private:
+    enum class SlotState { FREE, QUEUED, RENDERED };
+
+    struct Slot {
+        cv::Mat source;
+        cv::Mat rendered;
+        size_t index = 0;
+        SlotState state = SlotState::FREE;
+        bool rendered_ok = false;
+    };
+
+    void workerLoop();
+    void writerLoop();
+
+    RenderJob render;
+    WriteJob write;
+    Logger& logger;
+    std::vector<Slot> slots;
+
+    mutable std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable frameRendered;
+    std::condition_variable slotFreed;
+    std::deque<size_t> pendingSlots;
+    size_t submitted = 0;
+    size_t written = 0;
+    bool finishing = false;
+    double waitSeconds = 0.0;
+
+    std::vector<std::thread> workers;
+    std::thread writer;
+};
+
+#endif  // PARALLEL_RENDER_PASS_H
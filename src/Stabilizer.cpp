@@ -0,0 +1,102 @@
+#include "Stabilizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace {
+
+// Как в двухпроходном режиме: crop_y = рамка, crop_x - в пропорции ширины к высоте
+int borderCropX(const StabilizerOptions& options, cv::Size frame_size) {
+    return options.border_crop_pixels * frame_size.width / std::max(frame_size.height, 1);
+}
+
+}  // namespace
+
+Stabilizer::Stabilizer(cv::Size frame_size, Logger& logger, const StabilizerOptions& options)
+    : size(frame_size),
+      logger(logger),
+      options(options),
+      engine(borderCropX(options, frame_size), options.border_crop_pixels, logger,
+             [this](const cv::Mat& source, cv::Mat& stabilized, size_t index) {
+                 StabilizedFrame ready;
+                 ready.image = outputPool.acquire();
+                 cv::swap(ready.image, stabilized);
+                 ready.source = source;
+                 ready.index = index;
+                 readyFrames.push_back(std::move(ready));
+             },
+             options.analysis, options.history, options.lookahead) {
+    CV_Assert(frame_size.width > 0 && frame_size.height > 0);
+    if (options.analysis.input_format != PixelFormat::BGR) {
+        CV_Assert(frame_size.width % 2 == 0 && frame_size.height % 2 == 0);
+    }
+    this->options.history = std::max(options.history, 0);
+    this->options.lookahead = std::max(options.lookahead, 0);
+
+    engine.setRenderMode(options.render_mode);
+    engine.setChromaSiting(options.chroma_siting);
+    engine.setAdaptiveCrop(options.adaptive_crop);
+    if (options.analysis.target_fps > 0.0) {
+        AnalysisQuality base_quality;
+        base_quality.downscale = options.analysis.downscale;
+        budgetController = std::make_unique<AnalysisBudgetController>(
+            1.0 / options.analysis.target_fps, base_quality, MAX_ANALYSIS_DOWNSCALE);
+    }
+}
+
+void Stabilizer::push(const cv::Mat& frame) {
+    checkFrame(frame);
+    cv::Mat view = frame;  // только заголовок: данные остаются у вызывающего
+    pushChecked(view);
+}
+
+void Stabilizer::push(cv::Mat& frame) {
+    checkFrame(frame);
+    pushChecked(frame);
+}
+
+bool Stabilizer::pull(StabilizedFrame& frame) {
+    if (readyFrames.empty()) {
+        return false;
+    }
+    frame = std::move(readyFrames.front());
+    readyFrames.pop_front();
+    return true;
+}
+
+void Stabilizer::finish() { engine.finish(); }
+
+void Stabilizer::checkFrame(const cv::Mat& frame) const {
+    if (options.analysis.input_format == PixelFormat::BGR) {
+        CV_Assert(frame.type() == CV_8UC3 && frame.size() == size);
+    } else {
+        CV_Assert(frame.type() == CV_8UC1 && frame.cols == size.width &&
+                  frame.rows == size.height / 2 * 3);
+        // U и V кадра I420 ищутся сразу за Y по размеру плоскостей, без шага строки
+        if (options.analysis.input_format == PixelFormat::I420 && !frame.isContinuous()) {
+            CV_Error(cv::Error::StsBadArg, "Stabilizer: кадр I420 должен быть непрерывным "
+                                           "(шаг строки = ширина); кадр с шагом - NV12 или копия");
+        }
+    }
+}
+
+void Stabilizer::pushChecked(cv::Mat& frame) {
+    // Исходники готовых кадров обещаны только до следующего push(): отпускаем их,
+    // чтобы буфер, который вернётся вызывающему, больше ни на что не ссылался
+    for (StabilizedFrame& ready : readyFrames) {
+        ready.source.release();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    engine.pushFrame(frame);
+    pushedCount++;
+
+    // Бюджет - на кадр целиком: анализ и отрисовка идут в одном pushFrame
+    if (budgetController &&
+        budgetController->onFrame(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count())) {
+        logQualityChange(logger, pushedCount, *budgetController);
+        engine.setAnalysisQuality(budgetController->quality());
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef STABILIZER_H
+#define STABILIZER_H
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+#include "../include/Config.hpp"
+#include "AnalysisBudgetController.hpp"
+#include "FramePool.hpp"
+#include "FrameRenderer.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "MotionEstimator.hpp"
+#include "StreamingStabilizer.hpp"
+#include "TrajectoryDump.hpp"
+
+// Всё, что CLI берёт из ключей командной строки, для одного экземпляра Stabilizer
+struct StabilizerOptions {
+    AnalysisOptions analysis;  // формат кадров (BGR, I420, NV12) - analysis.input_format;
+                               // analysis.target_fps > 0 - анализ в бюджете времени кадра
+    int history = NFRAMES_SMOOTH_COEF;    // кадров назад в окне сглаживания
+    int lookahead = NFRAMES_SMOOTH_COEF;  // кадров вперёд; 0 - кадр отдаётся сразу
+    int border_crop_pixels = DEFAULT_BORDER_CROP_PIXELS;  // по другой оси - в пропорции кадра
+    bool adaptive_crop = false;  // рамка подбирается на ходу от border_crop_pixels
+    RenderMode render_mode = RenderMode::FUSED;
+    ChromaSiting chroma_siting = ChromaSiting::LEFT;  // для I420/NV12; MPEG-2, H.264
+};
+
+// Стабилизированный кадр из pull()
+struct StabilizedFrame {
+    cv::Mat image;   // в том же формате, что и вход
+    cv::Mat source;  // исходный кадр из push(), без копии; годен до следующего push()
+    size_t index = 0;  // номер кадра с нуля в порядке push()
+};
+
+// Стабилизатор для встраивания: кадры в памяти на входе и на выходе, без файлов и без
+// глобальных настроек - всё состояние в экземпляре, так что в одном процессе можно
+// держать сколько угодно стабилизаторов, каждый в своём потоке. Один экземпляр
+// из нескольких потоков одновременно не используется.
+//
+// Кадры входа не копируются: push() кладёт в кольцо сам cv::Mat, и если это вид на
+// чужой буфер (cv::Mat(rows, cols, type, data, step)), стабилизатор читает прямо из него.
+// Поэтому буфер кадра i должен жить и не меняться, пока не передан кадр i + heldFrames() - 1.
+// Стабилизированные кадры рисуются в буферы стабилизатора и отдаются через pull() без копии;
+// отработавший буфер можно вернуть через recycle(), тогда в установившемся режиме
+// стабилизатор не выделяет память.
+//
+// Внутри - StreamingStabilizer: один проход, окно [i - history, i + lookahead].
+class Stabilizer {
+   public:
+    // frame_size - размер изображения (для I420/NV12 - плоскости Y, чётный по обеим осям)
+    Stabilizer(cv::Size frame_size, Logger& logger, const StabilizerOptions& options = {});
+
+    // Кадр формата options.analysis.input_format размера frame_size, одним cv::Mat.
+    // I420 - непрерывный буфер, иначе cv::Exception. NV12 может быть видом с шагом строки
+    // больше ширины, но Y и UV - в одном буфере с общим шагом, UV сразу за Y: плоскости
+    // из разных буферов (как отдают некоторые декодеры) нужно сначала собрать в один.
+    // В ответ push() рисует не больше одного готового кадра.
+    void push(const cv::Mat& frame);
+
+    // Как push(const cv::Mat&), но frame обменивается с буфером кадра, который
+    // стабилизатору больше не нужен (или с пустым cv::Mat) - в него удобно декодировать
+    // следующий кадр
+    void push(cv::Mat& frame);
+
+    // Следующий готовый кадр; false - готовых нет. Кадры идут по порядку, но кадр, который
+    // не удалось отрисовать, пропускается (ошибка пишется в лог).
+    bool pull(StabilizedFrame& frame);
+
+    // Буфер из StabilizedFrame::image, который больше не нужен вызывающему
+    void recycle(cv::Mat&& image) { outputPool.release(std::move(image)); }
+
+    // Конец потока: после finish() через pull() отдаются оставшиеся кадры хвоста,
+    // а все буферы входа свободны
+    void finish();
+
+    // Сколько последних переданных кадров стабилизатор ещё читает
+    size_t heldFrames() const { return static_cast<size_t>(options.lookahead) + 2; }
+
+    // Серый кадр, анализ и отрисовка пишутся в metrics; nullptr - не писать
+    void setMetrics(Metrics* metrics) { engine.setMetrics(metrics); }
+
+    // Сдвиги и траектории - в dump вместо строк лога; nullptr - в лог
+    void setTrajectoryDump(TrajectoryDump* dump) { engine.setTrajectoryDump(dump); }
+
+    const StabilizerOptions& settings() const { return options; }
+    cv::Size frameSize() const { return size; }
+    size_t framesPushed() const { return pushedCount; }
+    size_t framesEmitted() const { return engine.framesEmitted(); }
+    size_t trackedPoints() const { return engine.trackedPoints(); }
+    int analysisDownscale() const { return engine.analysisDownscale(); }
+    int currentCropX() const { return engine.currentCropX(); }
+    int currentCropY() const { return engine.currentCropY(); }
+
+    // nullptr, если analysis.target_fps не задан
+    const AnalysisBudgetController* budget() const { return budgetController.get(); }
+
+   private:
+    void checkFrame(const cv::Mat& frame) const;
+    void pushChecked(cv::Mat& frame);
+
+    cv::Size size;
+    Logger& logger;
+    StabilizerOptions options;
+    StreamingStabilizer engine;
+    std::unique_ptr<AnalysisBudgetController> budgetController;
+    std::deque<StabilizedFrame> readyFrames;
+    FramePool outputPool;
+    size_t pushedCount = 0;
+};
+
+#endif  // STABILIZER_H
@@ -0,0 +1,205 @@
+#include "StreamingStabilizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+StreamingStabilizer::StreamingStabilizer(int crop_x, int crop_y, Logger& logger, FrameSink sink,
+                                         const AnalysisOptions& options, int history,
+                                         int lookahead)
+    : cropX(crop_x),
+      cropY(crop_y),
+      logger(logger),
+      sink(std::move(sink)),
+      history(static_cast<size_t>(std::max(history, 0))),
+      lookahead(static_cast<size_t>(std::max(lookahead, 0))),
+      analysisOptions(options),
+      estimator(logger, options),
+      frames(this->lookahead + 2),
+      trajectory(this->history + this->lookahead + 2) {}
+
+void StreamingStabilizer::pushFrame(cv::Mat& frame) {
+    cv::Mat& slot = frames[framesReceived % frames.size()];
+    cv::swap(slot, frame);
+
+    timeStage(metrics, Metrics::Stage::GRAYSCALE, [&] {
+        MotionEstimator::prepareGreyFrame(slot, greyFrames.current, analysisOptions);
+    });
+
+    if (framesReceived > 0) {
+        appendTrajectory(estimator.estimate(greyFrames.previous, greyFrames.current));
+
+        if (trajectoryLength > lookahead) {
+            emitFrame(trajectoryLength - 1 - lookahead, trajectoryLength);
+        }
+    }
+
+    greyFrames.advance();
+    framesReceived++;
+}
+
+void StreamingStabilizer::setMetrics(Metrics* metrics) {
+    this->metrics = metrics;
+    estimator.setMetrics(metrics);
+}
+
+void StreamingStabilizer::setAnalysisQuality(const AnalysisQuality& quality) {
+    estimator.setQuality(quality);
+    if (quality.downscale == analysisOptions.downscale) {
+        return;
+    }
+    analysisOptions.downscale = quality.downscale;
+    if (framesReceived > 0) {
+        const cv::Mat& previous_frame = frames[(framesReceived - 1) % frames.size()];
+        MotionEstimator::prepareGreyFrame(previous_frame, greyFrames.previous, analysisOptions);
+    }
+}
+
+void StreamingStabilizer::finish() {
+    while (emittedCount < trajectoryLength) {
+        emitFrame(emittedCount, trajectoryLength);
+    }
+}
+
+void StreamingStabilizer::appendTrajectory(const FrameTransformation& delta) {
+    position.position_x += delta.delta_x;
+    position.position_y += delta.delta_y;
+    position.angle += delta.delta_angle;
+    position.scale += delta.delta_scale;
+
+    windowSum.position_x += position.position_x;
+    windowSum.position_y += position.position_y;
+    windowSum.angle += position.angle;
+    windowSum.scale += position.scale;
+
+    trajectory[trajectoryLength % trajectory.size()] = {delta, position};
+    trajectoryLength++;
+
+    if (trajectoryDump != nullptr) {
+        trajectoryDump->record(TrajectoryDump::Kind::DELTA, trajectoryLength, delta.delta_x,
+                               delta.delta_y, delta.delta_angle, delta.delta_scale);
+        trajectoryDump->record(TrajectoryDump::Kind::TRAJECTORY, trajectoryLength,
+                               position.position_x, position.position_y, position.angle,
+                               position.scale);
+    } else if (logsScale()) {
+        logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Кадр="), trajectoryLength,
+                   LogLiteral(" delta_x="), delta.delta_x, LogLiteral(" delta_y="), delta.delta_y,
+                   LogLiteral(" delta_angle="), delta.delta_angle, LogLiteral(" delta_scale="),
+                   delta.delta_scale);
+    } else {
+        logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Кадр="), trajectoryLength,
+                   LogLiteral(" delta_x="), delta.delta_x, LogLiteral(" delta_y="), delta.delta_y,
+                   LogLiteral(" delta_angle="), delta.delta_angle);
+    }
+}
+
+void StreamingStabilizer::emitFrame(size_t index, size_t window_end) {
+    size_t window_begin = index >= history ? index - history : 0;
+    while (windowStart < window_begin) {
+        const MotionTrajectory& old = trajectory[windowStart % trajectory.size()].position;
+        windowSum.position_x -= old.position_x;
+        windowSum.position_y -= old.position_y;
+        windowSum.angle -= old.angle;
+        windowSum.scale -= old.scale;
+        windowStart++;
+    }
+
+    auto frames_in_window = static_cast<double>(window_end - windowStart);
+    double avg_x = windowSum.position_x / frames_in_window;
+    double avg_y = windowSum.position_y / frames_in_window;
+    double avg_a = windowSum.angle / frames_in_window;
+    double avg_s = windowSum.scale / frames_in_window;
+
+    if (trajectoryDump != nullptr) {
+        trajectoryDump->record(TrajectoryDump::Kind::SMOOTHED, index + 1, avg_x, avg_y, avg_a,
+                               avg_s);
+    } else if (logsScale()) {
+        logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Сглаженная раектория => Кадр:"),
+                   index + 1, LogLiteral(", avg_x="), avg_x, LogLiteral(", avg_y="), avg_y,
+                   LogLiteral(", avg_angle="), avg_a, LogLiteral(", avg_scale="), avg_s);
+    } else {
+        logger.log(LogLevel::TO_FILE_ONLY, LogLiteral("Сглаженная раектория => Кадр:"),
+                   index + 1, LogLiteral(", avg_x="), avg_x, LogLiteral(", avg_y="), avg_y,
+                   LogLiteral(", avg_angle="), avg_a);
+    }
+
+    const TrajectoryPoint& point = trajectory[index % trajectory.size()];
+    const cv::Mat& frame = frames[index % frames.size()];
+    double diff_x = avg_x - point.position.position_x;
+    double diff_y = avg_y - point.position.position_y;
+    double diff_a = avg_a - point.position.angle;
+    double diff_s = avg_s - point.position.scale;
+    FrameTransformation corrected(point.delta.delta_x + diff_x, point.delta.delta_y + diff_y,
+                                  point.delta.delta_angle + diff_a,
+                                  point.delta.delta_scale + diff_s);
+    if (adaptiveCrop) {
+        fitAdaptiveCrop(corrected, imageSize(frame, analysisOptions.input_format));
+    }
+
+    emittedCount++;
+
+    bool rendered = timeStage(metrics, Metrics::Stage::RENDER, [&] {
+        return renderStabilizedFrame(frame, corrected, cropX, cropY, stabilizedFrame, renderMode,
+                                     analysisOptions.input_format, chromaSiting);
+    });
+    if (!rendered) {
+        logger.log(LogLevel::ERROR, "Ошибка: Обрезка выходит за границы кадра! Пропускаем кадр.");
+        return;
+    }
+
+    sink(frame, stabilizedFrame, index);
+}
+
+// Рамка держит пропорции кадра: поле по вертикали (cropY, режет столбцы) - adaptiveMargin,
+// по горизонтали (cropX, режет строки) - в пропорции высоты к ширине.
+void StreamingStabilizer::fitAdaptiveCrop(FrameTransformation& corrected, cv::Size size) {
+    const double aspect = static_cast<double>(size.width) / size.height;
+    auto crop_x_for = [aspect](double margin) {
+        return static_cast<int>(std::ceil(margin / aspect));
+    };
+
+    // Наименьшее поле, при котором вся поправка (сдвиг, поворот вокруг угла кадра и
+    // масштаб) не открывает край кадра. Чем шире поле, тем меньше окно, поэтому бисекция.
+    int low = 0;
+    int high = std::min(MAX_CROP_PIXELS, size.width / 4);
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (cropCoversFrame(corrected, crop_x_for(middle), middle, size)) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    const auto target = static_cast<double>(low);
+
+    if (target > adaptiveMargin) {
+        adaptiveMargin = std::min(target, adaptiveMargin + LIVE_CROP_GROW_PX);
+    } else {
+        adaptiveMargin = std::max(target, adaptiveMargin - LIVE_CROP_SHRINK_PX);
+    }
+    cropY = static_cast<int>(std::ceil(adaptiveMargin));
+    cropX = crop_x_for(adaptiveMargin);
+
+    if (cropCoversFrame(corrected, cropX, cropY, size)) {
+        return;
+    }
+
+    // Рамка не успела дорасти: поправка урезается целиком, все четыре параметра в одной
+    // доле. Доля 0 - кадр без преобразования, он при любой рамке внутри себя.
+    const FrameTransformation full = corrected;
+    auto scaled = [&full](double share) {
+        return FrameTransformation(full.delta_x * share, full.delta_y * share,
+                                   full.delta_angle * share, full.delta_scale * share);
+    };
+    double fits = 0.0;
+    double fails = 1.0;
+    for (int i = 0; i < ADAPTIVE_CROP_SEARCH_STEPS; ++i) {
+        double share = (fits + fails) / 2.0;
+        if (cropCoversFrame(scaled(share), cropX, cropY, size)) {
+            fits = share;
+        } else {
+            fails = share;
+        }
+    }
+    corrected = scaled(fits);
+}
@@ -0,0 +1,111 @@
+#ifndef STREAMING_STABILIZER_H
+#define STREAMING_STABILIZER_H
+
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "../include/Config.hpp"
+#include "FramePool.hpp"
+#include "FrameRenderer.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "MotionEstimator.hpp"
+#include "MotionTypes.hpp"
+#include "TrajectoryDump.hpp"
+
+// Однопроходная стабилизация: каждый кадр декодируется один раз.
+// Траектория сглаживается скользящим окном [i - history, i + lookahead] с бегущей суммой,
+// кадр i отдаётся, как только пришла траектория i + lookahead. В памяти живут только
+// lookahead + 2 цветных кадра и history + lookahead + 2 точки траектории,
+// независимо от длины видео. lookahead = 0 - чисто причинный фильтр, кадр отдаётся сразу.
+class StreamingStabilizer {
+   public:
+    // (исходный кадр, стабилизированный кадр, номер кадра). Стабилизированный кадр можно
+    // забрать себе через cv::swap - тогда следующий рисуется в отданный взамен буфер.
+    using FrameSink = std::function<void(const cv::Mat&, cv::Mat&, size_t)>;
+
+    StreamingStabilizer(int crop_x, int crop_y, Logger& logger, FrameSink sink,
+                        const AnalysisOptions& options = {}, int history = NFRAMES_SMOOTH_COEF,
+                        int lookahead = NFRAMES_SMOOTH_COEF);
+
+    // Забирает кадр без копирования: frame обменивается с освободившимся буфером кольца,
+    // в который удобно декодировать следующий кадр.
+    void pushFrame(cv::Mat& frame);
+
+    // Конец видео: досглаживает и отдаёт оставшиеся кадры хвоста
+    void finish();
+
+    void setRenderMode(RenderMode mode) { renderMode = mode; }
+
+    // Положение отсчётов цветности для кадров I420/NV12
+    void setChromaSiting(ChromaSiting siting) { chromaSiting = siting; }
+
+    // Серый кадр, анализ и отрисовка пишутся в metrics; nullptr - не писать
+    void setMetrics(Metrics* metrics);
+
+    // Рамка подбирается на ходу: растёт вслед за поправками (не быстрее LIVE_CROP_GROW_PX
+    // за кадр) и медленно сужается, когда камера успокоилась. Поправка, которой не хватает
+    // текущей рамки, урезается целиком (сдвиг, угол и масштаб) - край кадра не открывается.
+    // Рамка конструктора - начальная.
+    void setAdaptiveCrop(bool enabled) {
+        adaptiveCrop = enabled;
+        adaptiveMargin = cropY;
+    }
+
+    // Смена параметров анализа на ходу (AnalysisBudgetController); при смене уменьшения
+    // предыдущий серый кадр пересчитывается из цветного, который ещё в кольце
+    void setAnalysisQuality(const AnalysisQuality& quality);
+
+    // Сдвиги, траектория и сглаженная траектория идут в dump вместо строк лога;
+    // nullptr - писать в лог
+    void setTrajectoryDump(TrajectoryDump* dump) { trajectoryDump = dump; }
+
+    size_t trackedPoints() const { return estimator.trackedPoints(); }
+    size_t framesEmitted() const { return emittedCount; }
+    int analysisDownscale() const { return analysisOptions.downscale; }
+    int currentCropX() const { return cropX; }
+    int currentCropY() const { return cropY; }
+
+   private:
+    struct TrajectoryPoint {
+        FrameTransformation delta;
+        MotionTrajectory position;
+    };
+
+    // Масштаб в строках лога - только у similarity, у других моделей он всегда 0
+    bool logsScale() const { return analysisOptions.motion_model == MotionModel::SIMILARITY; }
+
+    void appendTrajectory(const FrameTransformation& delta);
+    void emitFrame(size_t index, size_t window_end);
+    void fitAdaptiveCrop(FrameTransformation& corrected, cv::Size size);
+
+    int cropX;
+    int cropY;
+    Logger& logger;
+    FrameSink sink;
+    size_t history;
+    size_t lookahead;
+    AnalysisOptions analysisOptions;
+    RenderMode renderMode = RenderMode::FUSED;
+    ChromaSiting chromaSiting = ChromaSiting::LEFT;
+    Metrics* metrics = nullptr;
+    TrajectoryDump* trajectoryDump = nullptr;
+    bool adaptiveCrop = false;
+    double adaptiveMargin = 0.0;  // поле по горизонтали, пикселей; по вертикали - в пропорции
+
+    MotionEstimator estimator;
+    std::vector<cv::Mat> frames;                // кольцо кадров, индекс = номер кадра % size
+    std::vector<TrajectoryPoint> trajectory;    // кольцо траектории, индекс = номер % size
+    PingPongFrames greyFrames;
+    cv::Mat stabilizedFrame;
+
+    MotionTrajectory position{0.0, 0.0, 0.0, 0.0};   // накопленная траектория
+    MotionTrajectory windowSum{0.0, 0.0, 0.0, 0.0};  // сумма траектории в окне сглаживания
+    size_t framesReceived = 0;
+    size_t trajectoryLength = 0;
+    size_t emittedCount = 0;
+    size_t windowStart = 0;                     // первая точка, входящая в windowSum
+};
+
+#endif  // STREAMING_STABILIZER_H
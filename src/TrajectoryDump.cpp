@@ -0,0 +1,55 @@
+#include "TrajectoryDump.hpp"
+
+#include <filesystem>
+#include <limits>
+
+namespace {
+
+const char BINARY_MAGIC[8] = {'V', 'M', 'T', 'R', 'A', 'J', '0', '2'};
+const size_t DUMP_BUFFER_BYTES = 1 << 20;
+
+}  // namespace
+
+TrajectoryDump::TrajectoryDump(const std::string& path, Format format)
+    : format(format), buffer(DUMP_BUFFER_BYTES) {
+    file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.open(path, format == Format::BINARY ? std::ios::out | std::ios::binary : std::ios::out);
+
+    if (format == Format::BINARY) {
+        const auto entry_size = static_cast<uint32_t>(sizeof(Entry));
+        file.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        file.write(reinterpret_cast<const char*>(&entry_size), sizeof(entry_size));
+    } else {
+        file.precision(std::numeric_limits<double>::max_digits10);
+        file << "kind,frame,x,y,angle,scale\n";
+    }
+}
+
+void TrajectoryDump::record(Kind kind, size_t frame, double x, double y, double angle,
+                            double scale) {
+    if (format == Format::BINARY) {
+        const Entry entry{static_cast<uint32_t>(frame), kind, x, y, angle, scale};
+        file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    } else {
+        file << kindName(kind) << ',' << frame << ',' << x << ',' << y << ',' << angle << ','
+             << scale << '\n';
+    }
+}
+
+std::string TrajectoryDump::pathFor(const std::string& output_path, Format format) {
+    std::filesystem::path path(output_path);
+    path.replace_extension(format == Format::BINARY ? ".trajectory.bin" : ".trajectory.csv");
+    return path.string();
+}
+
+const char* TrajectoryDump::kindName(Kind kind) {
+    switch (kind) {
+        case Kind::DELTA:
+            return "delta";
+        case Kind::TRAJECTORY:
+            return "trajectory";
+        case Kind::SMOOTHED:
+            return "smoothed";
+    }
+    return "unknown";
+}
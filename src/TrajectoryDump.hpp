@@ -0,0 +1,44 @@
+#ifndef TRAJECTORY_DUMP_H
+#define TRAJECTORY_DUMP_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Покадровые числа - сдвиги, траектория, сглаженная траектория - в компактном файле
+// вместо строк лога. CSV: kind,frame,x,y,angle,scale без потери точности (scale - логарифм
+// масштаба). Бинарный формат: "VMTRAJ02", uint32 размер записи, затем записи Entry
+// в порядке байт машины.
+// Пишется из одного потока.
+class TrajectoryDump {
+   public:
+    enum class Kind : uint32_t { DELTA = 0, TRAJECTORY = 1, SMOOTHED = 2 };
+    enum class Format { CSV, BINARY };
+
+    struct Entry {
+        uint32_t frame;
+        Kind kind;
+        double x;
+        double y;
+        double angle;
+        double scale;
+    };
+
+    TrajectoryDump(const std::string& path, Format format);
+
+    bool isOpen() const { return file.is_open() && file.good(); }
+    void record(Kind kind, size_t frame, double x, double y, double angle, double scale);
+
+    // <output без расширения>.trajectory.csv | .trajectory.bin
+    static std::string pathFor(const std::string& output_path, Format format);
+
+   private:
+    static const char* kindName(Kind kind);
+
+    Format format;
+    std::vector<char> buffer;  // буфер ofstream побольше стандартного
+    std::ofstream file;
+};
+
+#endif  // TRAJECTORY_DUMP_H
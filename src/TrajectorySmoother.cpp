@@ -0,0 +1,100 @@
+#include "TrajectorySmoother.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../include/Config.hpp"
+
+MotionTrajectorySoA TrajectorySmoother::smooth(const MotionTrajectorySoA& trajectory) const {
+    MotionTrajectorySoA smoothed;
+    smoothed.resize(trajectory.size());
+
+    smoothChannel(trajectory.position_x.data(), smoothed.position_x.data(), trajectory.size());
+    smoothChannel(trajectory.position_y.data(), smoothed.position_y.data(), trajectory.size());
+    smoothChannel(trajectory.angle.data(), smoothed.angle.data(), trajectory.size());
+    smoothChannel(trajectory.scale.data(), smoothed.scale.data(), trajectory.size());
+
+    return smoothed;
+}
+
+BoxSmoother::BoxSmoother(int radius) : radius(static_cast<size_t>(std::max(radius, 0))) {}
+
+void BoxSmoother::boxFilter(const double* input, double* output, size_t count, size_t radius) {
+    if (count == 0) {
+        return;
+    }
+
+    // Траектория накопленная, поэтому суммы считаются от первой точки (base), а ошибка
+    // округления не копится от кадра к кадру благодаря суммированию Кэхэна
+    const double base = input[0];
+    std::vector<double> prefix(count + 1);
+    prefix[0] = 0.0;
+    double sum = 0.0;
+    double compensation = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        double term = (input[i] - base) - compensation;
+        double next = sum + term;
+        compensation = (next - sum) - term;
+        sum = next;
+        prefix[i + 1] = sum;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t begin = i >= radius ? i - radius : 0;
+        size_t end = std::min(count, i + radius + 1);
+        output[i] = base + (prefix[end] - prefix[begin]) / static_cast<double>(end - begin);
+    }
+}
+
+void BoxSmoother::smoothChannel(const double* input, double* output, size_t count) const {
+    boxFilter(input, output, count, radius);
+}
+
+GaussianSmoother::GaussianSmoother(double sigma) {
+    // Дисперсия окна ширины w = 2r + 1 равна (w^2 - 1) / 12, трёх проходов - втрое больше
+    double width = std::sqrt(4.0 * sigma * sigma + 1.0);
+    passRadius = static_cast<size_t>(std::max(0.0, std::round((width - 1.0) / 2.0)));
+}
+
+void GaussianSmoother::smoothChannel(const double* input, double* output, size_t count) const {
+    std::vector<double> buffer(count);
+    BoxSmoother::boxFilter(input, output, count, passRadius);
+    BoxSmoother::boxFilter(output, buffer.data(), count, passRadius);
+    BoxSmoother::boxFilter(buffer.data(), output, count, passRadius);
+}
+
+KalmanSmoother::KalmanSmoother(double process_noise, double measurement_noise)
+    : processNoise(process_noise), measurementNoise(measurement_noise) {}
+
+void KalmanSmoother::smoothChannel(const double* input, double* output, size_t count) const {
+    if (count == 0) {
+        return;
+    }
+
+    double estimate = input[0];
+    double error = 1.0;
+    output[0] = estimate;
+
+    for (size_t i = 1; i < count; ++i) {
+        double predicted_error = error + processNoise;
+        double gain = predicted_error / (predicted_error + measurementNoise);
+        estimate += gain * (input[i] - estimate);
+        error = (1.0 - gain) * predicted_error;
+        output[i] = estimate;
+    }
+}
+
+std::unique_ptr<TrajectorySmoother> createTrajectorySmoother(const std::string& name,
+                                                             int radius) {
+    if (name == "box") {
+        return std::make_unique<BoxSmoother>(radius);
+    }
+    if (name == "gaussian") {
+        return std::make_unique<GaussianSmoother>(radius / 2.0);
+    }
+    if (name == "kalman") {
+        return std::make_unique<KalmanSmoother>(KALMAN_PROCESS_NOISE, KALMAN_MEASUREMENT_NOISE);
+    }
+    return nullptr;
+}
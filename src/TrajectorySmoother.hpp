@@ -0,0 +1,78 @@
+#ifndef TRAJECTORY_SMOOTHER_H
+#define TRAJECTORY_SMOOTHER_H
+
+#include <memory>
+#include <string>
+
+#include "MotionTypes.hpp"
+
+// Сглаживатель траектории. Каждая координата (x, y, угол) сглаживается независимо,
+// все реализации линейны по числу кадров и не зависят от ширины окна.
+class TrajectorySmoother {
+   public:
+    virtual ~TrajectorySmoother() = default;
+
+    MotionTrajectorySoA smooth(const MotionTrajectorySoA& trajectory) const;
+
+    virtual const char* name() const = 0;
+
+    // false - ширина окна (--smooth-radius) на сглаживатель не влияет
+    virtual bool usesRadius() const { return true; }
+
+   protected:
+    virtual void smoothChannel(const double* input, double* output, size_t count) const = 0;
+};
+
+// Скользящее среднее по окну [i - radius, i + radius], у краёв окно обрезается.
+// Через префиксные суммы: O(N) вместо O(N * radius). С прямой суммой по окну результат
+// совпадает не побитово: разность префиксов теряет младшие разряды, и ошибка растёт
+// с длиной ролика и размахом траектории (отсчёт от первой точки и суммирование Кэхэна
+// держат её на уровне округления самих префиксов).
+class BoxSmoother : public TrajectorySmoother {
+   public:
+    explicit BoxSmoother(int radius);
+    const char* name() const override { return "box"; }
+
+    static void boxFilter(const double* input, double* output, size_t count, size_t radius);
+
+   protected:
+    void smoothChannel(const double* input, double* output, size_t count) const override;
+
+   private:
+    size_t radius;
+};
+
+// Гаусс через три прохода скользящего среднего (дисперсии складываются), тоже O(N)
+class GaussianSmoother : public TrajectorySmoother {
+   public:
+    explicit GaussianSmoother(double sigma);
+    const char* name() const override { return "gaussian"; }
+
+   protected:
+    void smoothChannel(const double* input, double* output, size_t count) const override;
+
+   private:
+    size_t passRadius;
+};
+
+// Причинный фильтр Калмана (модель случайного блуждания): смотрит только в прошлое,
+// годится там, где будущих кадров ещё нет
+class KalmanSmoother : public TrajectorySmoother {
+   public:
+    KalmanSmoother(double process_noise, double measurement_noise);
+    const char* name() const override { return "kalman"; }
+    bool usesRadius() const override { return false; }
+
+   protected:
+    void smoothChannel(const double* input, double* output, size_t count) const override;
+
+   private:
+    double processNoise;
+    double measurementNoise;
+};
+
+// box | gaussian | kalman; radius - полуширина окна для box, для gaussian sigma = radius / 2.
+// nullptr - неизвестное имя.
+std::unique_ptr<TrajectorySmoother> createTrajectorySmoother(const std::string& name, int radius);
+
+#endif  // TRAJECTORY_SMOOTHER_H
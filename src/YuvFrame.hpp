@@ -0,0 +1,72 @@
+#ifndef YUV_FRAME_H
+#define YUV_FRAME_H
+
+#include <opencv2/opencv.hpp>
+
+// Формат кадров, которые ходят по конвейеру
+enum class PixelFormat {
+    BGR,  // CV_8UC3, как отдаёт cv::VideoCapture
+    I420,  // YUV 4:2:0 одним CV_8UC1 размером width x height * 3 / 2 (см. cv::COLOR_YUV2BGR_I420):
+           // плоскость Y, за ней U и V, вдвое меньшие по каждой оси
+    NV12   // то же, но после Y - одна плоскость с чередующимися U и V (cv::COLOR_YUV2BGR_NV12)
+};
+
+// Где стоит отсчёт цветности 4:2:0 относительно блока 2x2 яркости
+enum class ChromaSiting {
+    CENTER,   // в центре блока: JPEG/MPEG-1, Y4M C420jpeg и C420 без суффикса
+    LEFT,     // на левом столбце, по вертикали посередине: MPEG-2, H.264/HEVC по умолчанию
+    TOP_LEFT  // на левом верхнем пикселе: Y4M C420paldv (приближённо)
+};
+
+struct I420Planes {
+    cv::Mat y;
+    cv::Mat u;
+    cv::Mat v;
+};
+
+// Плоскости кадра I420 - виды на его память без копирования. Кадр должен быть непрерывным,
+// ширина и высота - чётными. Y - вид через rowRange и держит кадр (счётчик ссылок), его можно
+// хранить дольше кадра; U и V по строкам кадра не нарезать, это голые указатели - только
+// пока жив кадр.
+inline I420Planes splitI420(const cv::Mat& frame) {
+    CV_Assert(frame.type() == CV_8UC1 && frame.isContinuous() && frame.rows % 3 == 0 &&
+              frame.cols % 2 == 0);
+    const int width = frame.cols;
+    const int height = frame.rows / 3 * 2;
+    const size_t luma_bytes = static_cast<size_t>(width) * height;
+    uchar* data = const_cast<uchar*>(frame.ptr());
+
+    return {frame.rowRange(0, height),
+            cv::Mat(height / 2, width / 2, CV_8UC1, data + luma_bytes),
+            cv::Mat(height / 2, width / 2, CV_8UC1, data + luma_bytes + luma_bytes / 4)};
+}
+
+struct Nv12Planes {
+    cv::Mat y;
+    cv::Mat uv;  // CV_8UC2, пара (U, V) на блок 2x2 яркости
+};
+
+// Плоскости кадра NV12 - виды на его память без копирования. В отличие от I420, у обеих
+// плоскостей один шаг строки, так что кадр может быть и видом с шагом больше ширины
+// (буфер камеры или декодера с выравниванием строк).
+inline Nv12Planes splitNV12(const cv::Mat& frame) {
+    CV_Assert(frame.type() == CV_8UC1 && frame.rows % 3 == 0 && frame.cols % 2 == 0);
+    const int width = frame.cols;
+    const int height = frame.rows / 3 * 2;
+    uchar* chroma = const_cast<uchar*>(frame.ptr(height));
+
+    return {frame.rowRange(0, height),
+            cv::Mat(height / 2, width / 2, CV_8UC2, chroma, frame.step)};
+}
+
+// Размер изображения в кадре: для BGR - сам кадр, для I420 и NV12 - плоскость Y
+inline cv::Size imageSize(const cv::Mat& frame, PixelFormat format) {
+    return format == PixelFormat::BGR ? frame.size() : cv::Size(frame.cols, frame.rows / 3 * 2);
+}
+
+// Плоскость Y кадра I420 или NV12 - вид без копирования
+inline cv::Mat lumaPlane(const cv::Mat& frame, PixelFormat format) {
+    return format == PixelFormat::NV12 ? splitNV12(frame).y : splitI420(frame).y;
+}
+
+#endif  // YUV_FRAME_H
@@ -0,0 +1,328 @@
+#include "YuvVideo.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+
+#include "../include/Config.hpp"
+
+namespace {
+
+const char Y4M_MAGIC[] = "YUV4MPEG2";
+const char Y4M_FRAME[] = "FRAME";
+const size_t Y4M_MAX_HEADER_BYTES = 4096;
+
+std::string lowerExtension(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+// Только 8-битные 4:2:0; C без суффикса и 420jpeg/420paldv/420mpeg2 различаются лишь
+// положением отсчётов цветности
+bool isSupportedColorspace(const std::string& tag) {
+    return tag == "C420" || tag == "C420jpeg" || tag == "C420paldv" || tag == "C420mpeg2";
+}
+
+// Тег C для положения цветности: без него читатель Y4M считает отсчёты центральными
+const char* colorspaceTag(ChromaSiting siting) {
+    switch (siting) {
+        case ChromaSiting::LEFT:
+            return "C420mpeg2";
+        case ChromaSiting::TOP_LEFT:
+            return "C420paldv";
+        case ChromaSiting::CENTER:
+        default:
+            return "C420jpeg";
+    }
+}
+
+bool hasColorspaceTag(const std::string& tags) {
+    return tags.rfind("C", 0) == 0 || tags.find(" C") != std::string::npos;
+}
+
+}  // namespace
+
+bool isYuvVideoPath(const std::string& path) {
+    std::string extension = lowerExtension(path);
+    return path == "-" || extension == ".y4m" || extension == ".yuv";
+}
+
+bool isRawYuvPath(const std::string& path) { return lowerExtension(path) == ".yuv"; }
+
+YuvReader::YuvReader(const std::string& path, const YuvFormat& raw_format, Logger& logger)
+    : logger(logger) {
+    opened = openInput(path, raw_format);
+}
+
+YuvReader::~YuvReader() {
+    if (mapping != nullptr) {
+        munmap(const_cast<uchar*>(mapping), mappingSize);
+    }
+    if (pipe != nullptr && pipe != stdin) {
+        std::fclose(pipe);
+    }
+}
+
+bool YuvReader::openInput(const std::string& path, const YuvFormat& raw_format) {
+    y4m = raw_format.width == 0;
+    if (!y4m) {
+        yuvFormat = raw_format;
+    }
+
+    if (path == "-") {
+        pipe = stdin;
+        std::setvbuf(pipe, nullptr, _IOFBF, YUV_PIPE_BUFFER_BYTES);
+    } else {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            return false;
+        }
+
+        if (S_ISREG(info.st_mode) && info.st_size > 0) {
+            mappingSize = static_cast<size_t>(info.st_size);
+            void* mapped =
+                mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (mapped == MAP_FAILED) {
+                return false;
+            }
+            madvise(mapped, mappingSize, MADV_SEQUENTIAL);
+            mapping = static_cast<const uchar*>(mapped);
+        } else {
+            // Именованный пайп или устройство - читаем потоком, как stdin
+            pipe = fdopen(fd, "rb");
+            if (pipe == nullptr) {
+                close(fd);
+                return false;
+            }
+            std::setvbuf(pipe, nullptr, _IOFBF, YUV_PIPE_BUFFER_BYTES);
+        }
+    }
+
+    if (y4m) {
+        std::string header;
+        if (mapping != nullptr) {
+            const auto* end = static_cast<const uchar*>(
+                std::memchr(mapping, '\n', std::min(mappingSize, Y4M_MAX_HEADER_BYTES)));
+            if (end != nullptr) {
+                header.assign(reinterpret_cast<const char*>(mapping), end - mapping);
+                firstFrameOffset = static_cast<size_t>(end - mapping) + 1;
+            }
+        } else {
+            readLine(header);
+        }
+        if (!parseY4MHeader(header)) {
+            return false;
+        }
+    }
+
+    if (yuvFormat.width <= 0 || yuvFormat.height <= 0 || yuvFormat.width % 2 != 0 ||
+        yuvFormat.height % 2 != 0) {
+        logger.log(LogLevel::ERROR, "Ошибка: размер YUV ", yuvFormat.width, "x",
+                   yuvFormat.height, " не задан или нечётный");
+        return false;
+    }
+
+    offset = firstFrameOffset;
+    return true;
+}
+
+bool YuvReader::parseY4MHeader(const std::string& header) {
+    std::istringstream tokens(header);
+    std::string token;
+    if (!(tokens >> token) || token != Y4M_MAGIC) {
+        logger.log(LogLevel::ERROR, "Ошибка: нет заголовка ", Y4M_MAGIC,
+                   " - для сырого YUV укажите --yuv-size=WxH");
+        return false;
+    }
+
+    std::string tags;
+    yuvFormat.chroma_siting = ChromaSiting::CENTER;
+    while (tokens >> token) {
+        char key = token[0];
+        std::string value = token.substr(1);
+        if (key == 'W') {
+            yuvFormat.width = std::atoi(value.c_str());
+        } else if (key == 'H') {
+            yuvFormat.height = std::atoi(value.c_str());
+        } else if (key == 'F') {
+            size_t colon = value.find(':');
+            yuvFormat.frame_rate_num = std::atoi(value.substr(0, colon).c_str());
+            yuvFormat.frame_rate_den =
+                colon == std::string::npos ? 1 : std::atoi(value.substr(colon + 1).c_str());
+        } else {
+            if (key == 'C' && !isSupportedColorspace(token)) {
+                logger.log(LogLevel::ERROR, "Ошибка: Y4M ", token,
+                           " не поддерживается, нужен 8-битный 4:2:0");
+                return false;
+            }
+            if (key == 'C') {
+                yuvFormat.chroma_siting = token == "C420mpeg2"   ? ChromaSiting::LEFT
+                                          : token == "C420paldv" ? ChromaSiting::TOP_LEFT
+                                                                 : ChromaSiting::CENTER;
+            }
+            tags += tags.empty() ? token : " " + token;
+        }
+    }
+    if (yuvFormat.frame_rate_num <= 0 || yuvFormat.frame_rate_den <= 0) {
+        yuvFormat.frame_rate_num = 25;
+        yuvFormat.frame_rate_den = 1;
+    }
+    yuvFormat.y4m_tags = tags;
+    return true;
+}
+
+bool YuvReader::readLine(std::string& line) {
+    line.clear();
+    int c = 0;
+    while ((c = std::fgetc(pipe)) != EOF && c != '\n') {
+        if (line.size() >= Y4M_MAX_HEADER_BYTES) {
+            return false;
+        }
+        line.push_back(static_cast<char>(c));
+    }
+    return c == '\n';
+}
+
+// Заголовок кадра Y4M: "FRAME" и, возможно, параметры до конца строки
+bool YuvReader::skipFrameHeader() {
+    if (!y4m) {
+        return true;
+    }
+
+    if (mapping != nullptr) {
+        size_t available = std::min(mappingSize - offset, Y4M_MAX_HEADER_BYTES);
+        const auto* end = static_cast<const uchar*>(std::memchr(mapping + offset, '\n',
+                                                                available));
+        if (end == nullptr ||
+            std::memcmp(mapping + offset, Y4M_FRAME, sizeof(Y4M_FRAME) - 1) != 0) {
+            return false;
+        }
+        offset = static_cast<size_t>(end - mapping) + 1;
+        return true;
+    }
+
+    std::string line;
+    return readLine(line) && line.compare(0, sizeof(Y4M_FRAME) - 1, Y4M_FRAME) == 0;
+}
+
+bool YuvReader::read(cv::Mat& frame) {
+    if (!opened) {
+        return false;
+    }
+
+    const int rows = yuvFormat.height * 3 / 2;
+    const size_t frame_bytes = yuvFormat.frameBytes();
+
+    if (mapping != nullptr) {
+        if (offset >= mappingSize || !skipFrameHeader() || mappingSize - offset < frame_bytes) {
+            frame.release();
+            return false;
+        }
+        frame = cv::Mat(rows, yuvFormat.width, CV_8UC1, const_cast<uchar*>(mapping + offset));
+        offset += frame_bytes;
+        return true;
+    }
+
+    // Буфер, на который ссылаются другие (серый кадр-вид, кольцо кадров), не трогаем
+    if (frame.u == nullptr || frame.u->refcount > 1) {
+        frame.release();
+    }
+    if (!skipFrameHeader()) {
+        frame.release();
+        return false;
+    }
+    frame.create(rows, yuvFormat.width, CV_8UC1);
+    if (std::fread(frame.data, 1, frame_bytes, pipe) != frame_bytes) {
+        frame.release();
+        return false;
+    }
+    return true;
+}
+
+bool YuvReader::rewind() {
+    if (mapping == nullptr) {
+        return false;
+    }
+    offset = firstFrameOffset;
+    return true;
+}
+
+VideoInfo YuvReader::info() const {
+    double total_frames = 0.0;
+    if (mapping != nullptr) {
+        // Y4M: считаем, что заголовки кадров - просто "FRAME\n"
+        size_t record_bytes = yuvFormat.frameBytes() + (y4m ? sizeof(Y4M_FRAME) : 0);
+        total_frames = static_cast<double>((mappingSize - firstFrameOffset) / record_bytes);
+    }
+    double frame_rate = yuvFormat.frameRate();
+    return {static_cast<double>(yuvFormat.width), static_cast<double>(yuvFormat.height),
+            frame_rate, total_frames, total_frames / frame_rate};
+}
+
+YuvWriter::YuvWriter(const std::string& path, const YuvFormat& format, bool y4m, Logger& logger)
+    : logger(logger), yuvFormat(format), y4m(y4m), toStdout(path == "-") {
+    file = toStdout ? stdout : std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return;
+    }
+    // Кадр и так пишется одним fwrite; буфер нужен только для мелких заголовков
+    std::setvbuf(file, nullptr, _IOFBF, YUV_PIPE_BUFFER_BYTES);
+
+    if (y4m) {
+        std::ostringstream header;
+        header << Y4M_MAGIC << " W" << format.width << " H" << format.height << " F"
+               << format.frame_rate_num << ":" << format.frame_rate_den;
+        if (!format.y4m_tags.empty()) {
+            header << " " << format.y4m_tags;
+        }
+        // Сырой YUV приходит без тегов, а его цветность не по центру
+        if (!hasColorspaceTag(format.y4m_tags)) {
+            header << " " << colorspaceTag(format.chroma_siting);
+        }
+        header << "\n";
+        std::string text = header.str();
+        std::fwrite(text.data(), 1, text.size(), file);
+    }
+}
+
+YuvWriter::~YuvWriter() {
+    if (file == nullptr) {
+        return;
+    }
+    std::fflush(file);
+    if (!toStdout) {
+        std::fclose(file);
+    }
+}
+
+void YuvWriter::write(const cv::Mat& frame) {
+    if (file == nullptr || failed) {
+        return;
+    }
+    CV_Assert(frame.isContinuous() && frame.total() == yuvFormat.frameBytes());
+
+    bool ok = !y4m || std::fputs("FRAME\n", file) >= 0;
+    ok = ok && std::fwrite(frame.data, 1, yuvFormat.frameBytes(), file) == yuvFormat.frameBytes();
+    if (!ok) {
+        // Обычно - закрытый с той стороны пайп; дальше писать бессмысленно
+        logger.log(LogLevel::ERROR, "Ошибка записи YUV: ", std::strerror(errno));
+        failed = true;
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef YUV_VIDEO_H
+#define YUV_VIDEO_H
+
+#include <cstdio>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+#include "MotionTypes.hpp"
+#include "YuvFrame.hpp"
+
+// Параметры несжатого видео 4:2:0. Для Y4M берутся из заголовка, для сырого YUV
+// задаются снаружи (--yuv-size, --yuv-fps).
+struct YuvFormat {
+    int width = 0;
+    int height = 0;
+    int frame_rate_num = 25;
+    int frame_rate_den = 1;
+    std::string y4m_tags;  // остальные поля заголовка Y4M (I, A, C, X) - переносятся на выход
+    // Y4M - по тегу C (без тега - C420jpeg, центр); сырой YUV - как у MPEG-2 и H.264
+    ChromaSiting chroma_siting = ChromaSiting::LEFT;
+
+    size_t frameBytes() const { return static_cast<size_t>(width) * height * 3 / 2; }
+    double frameRate() const { return static_cast<double>(frame_rate_num) / frame_rate_den; }
+};
+
+// Y4M или сырой YUV420 (I420), файл или stdin ("-"). Кадры отдаются в формате
+// PixelFormat::I420. Обычный файл отображается в память целиком, и кадр - вид на
+// отображение без копирования (запись в него остаётся в частной копии страницы).
+// Из пайпа кадр читается в буфер frame; буфер, на который ещё кто-то ссылается,
+// не перезаписывается - вместо него берётся новый.
+class YuvReader {
+   public:
+    // raw_format.width == 0 - ждём Y4M, иначе сырой YUV этого размера
+    YuvReader(const std::string& path, const YuvFormat& raw_format, Logger& logger);
+    ~YuvReader();
+
+    YuvReader(const YuvReader&) = delete;
+    YuvReader& operator=(const YuvReader&) = delete;
+
+    bool isOpened() const { return opened; }
+    bool read(cv::Mat& frame);
+
+    // К первому кадру; пайп перемотать нельзя - false
+    bool rewind();
+    bool isSeekable() const { return mapping != nullptr; }
+
+    const YuvFormat& format() const { return yuvFormat; }
+    bool isY4M() const { return y4m; }
+
+    // Число кадров по размеру файла; для пайпа 0 - неизвестно
+    VideoInfo info() const;
+
+   private:
+    bool openInput(const std::string& path, const YuvFormat& raw_format);
+    bool parseY4MHeader(const std::string& header);
+    bool readLine(std::string& line);  // только для пайпа
+    bool skipFrameHeader();
+
+    Logger& logger;
+    YuvFormat yuvFormat;
+    bool y4m = false;
+    bool opened = false;
+
+    // Отображённый файл
+    const uchar* mapping = nullptr;
+    size_t mappingSize = 0;
+    size_t firstFrameOffset = 0;
+    size_t offset = 0;
+
+    // Пайп
+    std::FILE* pipe = nullptr;
+};
+
+// Y4M или сырой YUV420 (I420) в файл или в stdout ("-"). Кадр пишется из своего буфера
+// целиком, одним вызовом, без промежуточного преобразования в BGR.
+class YuvWriter {
+   public:
+    YuvWriter(const std::string& path, const YuvFormat& format, bool y4m, Logger& logger);
+    ~YuvWriter();
+
+    YuvWriter(const YuvWriter&) = delete;
+    YuvWriter& operator=(const YuvWriter&) = delete;
+
+    bool isOpened() const { return file != nullptr; }
+    void write(const cv::Mat& frame);
+
+   private:
+    Logger& logger;
+    YuvFormat yuvFormat;
+    bool y4m;
+    bool toStdout;
+    std::FILE* file = nullptr;
+    bool failed = false;
+};
+
+// "-" (stdin) или файл .y4m/.yuv - такое видео читается YuvReader, а не cv::VideoCapture
+bool isYuvVideoPath(const std::string& path);
+bool isRawYuvPath(const std::string& path);
+
+#endif  // YUV_VIDEO_H